@@ -1,5 +1,6 @@
 #pragma once
 
+#include <charconv>
 #include <cstdio>
 #include <cstdint>
 #include <cstring>
@@ -7,16 +8,23 @@
 #include <iostream>
 #include <list>
 #include <map>
-#include <regex>
-#include <stack>
 #include <string>
 #include <vector>
 
-#include "random.h"
+#include "kpk.h"
+#include "material.h"
 #include "types.h"
+#include "weights.h"
+#include "zobrist.h"
 
-// number of positions stored in the transposition table
-#define NPOSITIONS 32500
+// FEN description of the classical starting position
+#define STARTING_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+
+// maximum number of plies that can be played from the starting position of a board (game and search combined)
+#define MAX_PLIES 2048
+
+// size of a FEN buffer (the longest FEN string plus a terminator)
+#define FEN_SIZE 96
 
 // resolves to the (absolute) rank number of `color`'s `n`th rank (1-8)
 #define RANK(color, n) ((Rank) (color ? (9 - n) : n))
@@ -59,307 +67,271 @@ const std::map<PieceType, std::list<CoordOffset>> PIECE_OFFSETS[2] = {
     }
 };
 
-// Unicode representation of pieces
-const char PIECES[2][7][4] = {
-    {"\u2659", "\u2658", "\u2657", "\u2656", "\u2655", "\u2654"},
-    {"\u265f", "\u265e", "\u265d", "\u265c", "\u265b", "\u265a"}
+// terms of the heuristic evaluation (each the difference between white's and black's count), which are weighed linearly
+enum EvalTerm {
+    TERM_PAWNS, TERM_KNIGHTS, TERM_BISHOPS, TERM_ROOKS, TERM_QUEENS, TERM_BISHOP_PAIR, // material
+    TERM_DOUBLED_PAWNS, TERM_ISOLATED_PAWNS, // pawn structure
+    TERM_MOBILITY, // number of pseudolegal moves
+    EVAL_TERMS
 };
 
-// piece values (measured in centipawns)
-const int PIECE_VALUES[6] = { 100, 300, 300, 500, 900, 99999 };
+// weight of each evaluation term (in centipawns)
+const int EVAL_WEIGHTS[EVAL_TERMS] = {
+    PIECE_VALUES[PAWN], PIECE_VALUES[KNIGHT], PIECE_VALUES[BISHOP], PIECE_VALUES[ROOK], PIECE_VALUES[QUEEN], BISHOP_PAIR_BONUS,
+    -DOUBLED_PAWN_PENALTY, -ISOLATED_PAWN_PENALTY,
+    MOBILITY_BONUS
+};
 
-// unit vectors for rank and file offsets
-const CoordOffset DELTA_RANK = {0, 1};
-const CoordOffset DELTA_FILE = {1, 0};
+// evaluation of a won king and pawn versus king ending (plus a bonus for each rank the pawn has advanced, so that the
+// evaluation still increases up to and after promotion)
+const int KPK_WIN = 200;
+const int KPK_RANK_BONUS = 50;
+
+// evaluation of mating material versus a bare king (plus bonuses for driving the bare king to the edge, or to a corner
+// the bishop controls with bishop and knight, and for bringing the kings together)
+const int KXK_WIN = 1000;
+const int KXK_EDGE_BONUS = 20;
+const int KXK_CLOSE_BONUS = 10;
 
 class Board {
 public:
     GameResult result = GameResult::IN_PROGRESS;
     PieceColor toPlay = PieceColor::WHITE;
+    unsigned int fullmoves = 1; // full move number (incremented after each move by black)
 
     enum Side { QUEEN, KING };
 
-    SquareColor colors[9][9]; // square colors used for display() calls
-    Square board[9][9] = {NULL}; // board representation
-    std::stack<GameState> states; // stack of board state information
-    std::list<Move> moves; // list of moves made this game
-    std::list<Piece> pieces[2]; // list of all pieces
-    std::map<PieceType, std::list<Piece *>> remaining[2]; // remaining pieces (pieces still on the board)
-    std::map<PieceType, std::list<Piece *>> captured[2]; // captured pieces (pieces no longer on the board)
-    std::string fg[2] = {"\x1b[38:5:255m", "\x1b[38:5:232m"}; // foreground terminal color
-    std::string bg[2] = {"\x1b[48:5:248m", "\x1b[48:5:240m"}; // background terminal color
-
-    // Zobrist hashing data
-    uint64_t zobristPieces[2][6][9][9]; // Zobrist hash value for encoding color/piece-type/square combos
-    uint64_t zobristCastling[2][2]; // Zobrist hash value for castling rights
-    uint64_t zobristPassant[9]; // Zobrist hash value for en passant candidate files
-    uint64_t zobristBlackToPlay; // Zobrist hash value for encoding that black is to play
-    Position transpositionTable[NPOSITIONS]; // transposition table
-
-    // number of times each position has been reached (used for detecting draws by repetition)
-    std::map<ZobristHash, uint8_t> occurences;
-
-    // initialize Zobrist hash values
-    void initHashValues() {
-        Random random;
-
-        for(PieceColor color : {WHITE, BLACK}) {
-            // color-piece-square combos
-            for(PieceType type : PIECE_TYPES)
-                for(Rank rank = 1; rank <= 8; rank++)
-                    for(File file = File::A; file <= File::H; file++)
-                        zobristPieces[color][type][rank][file] = random.rand64();
-
-            // castling rights
-            for(Side side : {Side::QUEEN, Side::KING}) zobristCastling[color][side] = random.rand64();
-        }
-        
-        // passant files
-        for(File file = File::A; file <= File::H; file++)
-            zobristPassant[file] = random.rand64();
-
-        // black to play
-        zobristBlackToPlay = random.rand64();
-    }
+    SquareColor colors[9][9]; // square colors (for the display and bishop endings)
+    Square board[9][9] = {EMPTY}; // board representation (piece codes)
+    PieceList remaining[2][6]; // squares of the remaining pieces (pieces still on the board) by color and type
+    GameState states[MAX_PLIES]; // board state information indexed by ply, meaningful up to the current ply (the moves themselves are kept by the caller)
+    uint16_t ply = 0; // number of plies played since the position was set up (index of the current state)
 
 public:
-    Square& operator[](Coord& coord) {
+    Square& operator[](const Coord& coord) {
         return board[coord.rank][coord.file];
     }
 
-    inline Square& operator[](const Coord& coord) {
-        return operator[]((Coord&)coord);
+    Square operator[](const Coord& coord) const {
+        return board[coord.rank][coord.file];
     }
 
-    std::map<PieceType, std::vector<Range>> PIECE_RANGES = {
-        {
-            PieceType::ROOK, {
-                Range(DELTA_FILE,  DELTA_FILE), Range(-DELTA_FILE, -DELTA_FILE),
-                Range(DELTA_RANK,  DELTA_RANK), Range(-DELTA_RANK, -DELTA_RANK)
-            }
-        }, {
-            PieceType::BISHOP, {
-                Range(DELTA_RANK + DELTA_FILE, DELTA_RANK + DELTA_FILE), Range(DELTA_RANK - DELTA_FILE, DELTA_RANK - DELTA_FILE),
-                Range(-DELTA_RANK + DELTA_FILE, -DELTA_RANK + DELTA_FILE), Range(-DELTA_RANK - DELTA_FILE, -DELTA_RANK - DELTA_FILE)
-            }
-        }, { PieceType::QUEEN, {
-                Range(DELTA_FILE,  DELTA_FILE), Range(-DELTA_FILE, -DELTA_FILE),
-                Range(DELTA_RANK,  DELTA_RANK), Range(-DELTA_RANK, -DELTA_RANK),
-                Range(DELTA_RANK + DELTA_FILE, DELTA_RANK + DELTA_FILE), Range(DELTA_RANK - DELTA_FILE, DELTA_RANK - DELTA_FILE),
-                Range(-DELTA_RANK + DELTA_FILE, -DELTA_RANK + DELTA_FILE), Range(-DELTA_RANK - DELTA_FILE, -DELTA_RANK - DELTA_FILE)
-            }
-        }
-    };
-
     // whether coordinate is on board
     static bool onBoard(Coord coord) {
         return (1 <= coord.rank) && (coord.rank <= 8) && (File::A <= coord.file) && (coord.file <= File::H);
     };
 
     // classical starting position (default)
-    Board() {
-        initHashValues();
-
-        // initialize board state
-        GameState state;
-        state.canCastle[PieceColor::WHITE][Side::QUEEN] = true;
-        state.canCastle[PieceColor::BLACK][Side::QUEEN] = true;
-        state.canCastle[PieceColor::WHITE][Side::KING] = true;
-        state.canCastle[PieceColor::BLACK][Side::KING] = true;
-        state.passant = (Piece *) NULL;
-        states.push(state);
-
-        // place pieces on the board
-        for (PieceColor color : {PieceColor::WHITE, PieceColor::BLACK}) {
-            /* place front rank */
-            Rank rank = RANK(color, 2);
-
-            // place pawns
-            for (File file = File::A; file <= File::H; file++) {
-                Piece pawn = {color, PieceType::PAWN, {file, rank}};
-                pieces[color].push_back(pawn);
-                board[rank][file] = &pieces[color].back();
-            }
-
-            /* place back rank */
-            rank = RANK(color, 1);
-
-            // place rooks
-            Piece queensRook = { color, PieceType::ROOK, {File::A, rank} };
-            pieces[color].push_back(queensRook);
-            board[rank][A] = &pieces[color].back();
-
-            Piece kingsRook = { color, PieceType::ROOK, {File::H, rank} };
-            pieces[color].push_back(kingsRook);
-            board[rank][H] = &pieces[color].back();
-
-            // place knights
-            Piece queensKnight = { color, PieceType::KNIGHT, {File::B, rank} };
-            pieces[color].push_back(queensKnight);
-            board[rank][B] = &pieces[color].back();
-
-            Piece kingsKnight  = { color, PieceType::KNIGHT, {File::G, rank} };
-            pieces[color].push_back(kingsKnight);
-            board[rank][G] = &pieces[color].back();
-
-            // place bishops
-            Piece queensBishop = { color, PieceType::BISHOP, {File::C, rank} };
-            pieces[color].push_back(queensBishop);
-            board[rank][C] = &pieces[color].back();
-
-            Piece kingsBishop  = { color, PieceType::BISHOP, {File::F, rank} };
-            pieces[color].push_back(kingsBishop);
-            board[rank][F] = &pieces[color].back();
-
-            // place queen
-            Piece queen = { color, PieceType::QUEEN, {File::D, rank} };
-            pieces[color].push_back(queen);
-            board[rank][D] = &pieces[color].back();
-
-            // place king
-            Piece king = { color, PieceType::KING, {File::E, rank} };
-            pieces[color].push_back(king);
-            board[rank][E] = &pieces[color].back();
-        }
-
-        // load list of references to remaining pieces (all pieces)
-        for (uint8_t color = PieceColor::WHITE; color <= PieceColor::BLACK; color++)
-            for (Piece& piece : pieces[color])
-                remaining[color][piece.type].push_back(&piece);
+    Board() : Board(STARTING_FEN) {}
+
+    // copies only take the states up to the current ply, so their cost follows the game rather than the array
+    Board(const Board& other) { *this = other; }
+
+    Board& operator=(const Board& other) {
+        result = other.result;
+        toPlay = other.toPlay;
+        fullmoves = other.fullmoves;
+        memcpy(colors, other.colors, sizeof(colors));
+        memcpy(board, other.board, sizeof(board));
+        memcpy(remaining, other.remaining, sizeof(remaining));
+        ply = other.ply;
+        memcpy(states, other.states, (ply + 1) * sizeof(GameState));
+        return *this;
+    }
 
-        // cache square colors for faster display() calls
+    // load board state from FEN string
+    Board(std::string_view fen) {
+        // cache square colors
         for (Rank rank = 1; rank <= 8; rank++)
             for (File file = File::A; file <= File::H; file++)
                 colors[rank][file] = (SquareColor) ((rank + file + 1) % 2);
-        
-        // load position Zobrist key into positions list
-        occurences[hash()] = 1;
-    }
-
-    // load board state from FEN string
-    Board(std::string fen) {
-        const std::regex FEN("^([PNBRQKpnbrqk1-8]+)(\\/[PNBRQKpnbrqk1-8]+){7} [wb] (-|(K?Q?k?q?)) (-|([a-h][1-8])) [0-9]+ [0-9]+$");
 
         // invalid format
-        if(!std::regex_match(fen, FEN)) {
+        if(!setPosition(fen)) {
             std::cerr << "invalid FEN text\n";
             exit(EXIT_FAILURE);
         }
+    }
+
+    // reset the board in place to the position described by `fen` - returns false if `fen` is malformed, in which case the board is left in an unspecified state. The half and full
+    // move counters are optional
+    bool setPosition(std::string_view fen) {
+        clear();
 
-        // initialize Zobrist hash position encodings
-        initHashValues();
+        // returns the next whitespace-separated field
+        auto field = [&fen]() {
+            const size_t begin = std::min(fen.find_first_not_of(" \t\r\n"), fen.size());
+            const size_t end = std::min(fen.find_first_of(" \t\r\n", begin), fen.size());
+            std::string_view token = fen.substr(begin, end - begin);
+            fen.remove_prefix(end);
+            return token;
+        };
 
         // piece placement
-        size_t curr = 0;
-        size_t next = fen.find(" ");
-        std::string token = fen.substr(curr, next - curr);
-
-        size_t c = 0;
-        size_t n;
-        for(uint8_t rank = 8; rank >= 1; rank--) {
-            n = token.find("/", c);
-            if(n == std::string::npos) n = token.size();
-
-            std::string rankString = token.substr(c, n - c);
-            File file = File::A;
-
-            for(char c : rankString) {
-                int piece = (PieceType) std::string("PNBRQKpnbrqk").find(c);
-                if(piece == std::string::npos) file = file + (c - '1');
-                else {
-                    PieceColor color = (PieceColor) (piece / 6);
-                    PieceType type = (PieceType) (piece % 6);
-                    pieces[color].push_back((Piece) {
-                        .color = color,
-                        .type = type,
-                        .location = {file, rank}
-                    });
-                    board[rank][file] = &pieces[color].back();
-                }
+        Rank rank = 8;
+        File file = File::A;
+        for(char c : field()) {
+            if(c == '/') {
+                if(file != File::H + 1 || rank == 1) return false;
+                rank--;
+                file = File::A;
+            } else if('1' <= c && c <= '8') {
+                file = file + (c - '0');
+                if(file > File::H + 1) return false;
+            } else {
+                const size_t piece = std::string_view("PNBRQKpnbrqk").find(c);
+                if(piece == std::string_view::npos || file > File::H) return false;
+
+                const PieceColor color = (PieceColor) (piece / 6);
+                const PieceType type = (PieceType) (piece % 6);
+                if(!place(color, type, {file, rank})) return false;
                 file++;
             }
-
-            c = n + 1;
         }
+        if(rank != 1 || file != File::H + 1) return false;
+        if(remaining[WHITE][PieceType::KING].size() != 1 || remaining[BLACK][PieceType::KING].size() != 1) return false;
 
         // side to play
-        curr = next + 1;
-        next = fen.find(" ", curr);
-        token = fen.substr(curr, next - curr);
-        toPlay = (PieceColor) std::string("wb").find(token[0]);
-
-        // castling rights
-        GameState state;
-        curr = next + 1;
-        next = fen.find(" ", curr);
-        token = fen.substr(curr, next - curr);
-        state.canCastle[0][0] = false;
-        state.canCastle[0][1] = false;
-        state.canCastle[1][0] = false;
-        state.canCastle[1][1] = false;
+        std::string_view token = field();
+        if(token != "w" && token != "b") return false;
+        toPlay = (token == "w") ? WHITE : BLACK;
+
+        // castling rights (only kept if the king and rook are still on their original squares)
+        GameState& state = states[0];
+        state = {0, 0, {{false, false}, {false, false}}, File::NONE, 0, EMPTY, EMPTY, EMPTY, false, {File::NONE, 0}, {File::NONE, 0}};
+        token = field();
+        if(token.empty()) return false;
         if(token != "-") for(char c : token) {
-            int i = std::string("QKqk").find(c);
-            state.canCastle[i / 2][i % 2] = true;
+            const size_t i = std::string_view("QKqk").find(c);
+            if(i == std::string_view::npos) return false;
+
+            const PieceColor color = (PieceColor) (i / 2);
+            state.canCastle[color][i % 2] = board[RANK(color, 1)][File::E] == PIECE_CODE(color, PieceType::KING)
+                                         && board[RANK(color, 1)][(i % 2) ? File::H : File::A] == PIECE_CODE(color, ROOK);
         }
 
-        // passant candidate
-        curr = next + 1;
-        next = fen.find(" ", curr);
-        token = fen.substr(curr, next - curr);
-        state.passant = NULL;
+        // passant candidate (the pawn that can be captured, which stands in front of the target square)
+        token = field();
+        if(token.empty()) return false;
         if(token != "-") {
-            Piece * piece = board[token[0] - '`'][token[1] - '0'];
-            state.passant = piece;
+            if(token.size() != 2 || token[0] < 'a' || token[0] > 'h' || (token[1] != '3' && token[1] != '6')) return false;
+            const Rank rank = (token[1] == '3') ? 4 : 5;
+            const File file = (File) (token[0] - '`');
+            if(rank == RANK(!toPlay, 4) && board[rank][file] == PIECE_CODE(!toPlay, PAWN)) state.passant = file;
         }
 
-        // half moves
-        curr = next + 1;
-        next = fen.find(" ", curr);
-        token = fen.substr(curr, next - curr);
-        state.plies = std::stoi(token);
+        // half and full move counters
+        unsigned int halfmoves = 0;
+        fullmoves = 1;
+        for(unsigned int * counter : {&halfmoves, &fullmoves}) {
+            token = field();
+            if(token.empty()) break;
+            if(std::from_chars(token.data(), token.data() + token.size(), *counter).ptr != token.data() + token.size()) return false;
+        }
+        state.plies = std::min(halfmoves, 100u);
+        fullmoves = std::max(fullmoves, 1u);
 
-        // full moves
-        curr = next + 1;
-        next = fen.length();
-        token = fen.substr(curr, next - curr);
+        finishSetup();
+        return field().empty();
+    }
 
-        // load list of references to remaining pieces (all pieces)
-        for (uint8_t color = PieceColor::WHITE; color <= PieceColor::BLACK; color++)
-            for (Piece& piece : pieces[color])
-                remaining[color][piece.type].push_back(&piece);
+    // remove every piece and reset the game state (the first step of setting up a position)
+    void clear() {
+        memset(board, 0, sizeof(board));
+        for (PieceColor color : {PieceColor::WHITE, PieceColor::BLACK})
+            for (PieceType type : PIECE_TYPES) remaining[color][type].clear();
+        ply = 0;
+        result = GameResult::IN_PROGRESS;
+    }
 
-        // cache square colors for faster display() calls
-        for (Rank rank = 1; rank <= 8; rank++)
-            for (File file = File::A; file <= File::H; file++)
-                colors[rank][file] = (SquareColor) ((rank + file + 1) % 2);
+    // put a piece on the empty square `location` while setting up a position - returns false if a pawn is placed on the
+    // first or last rank or the color already has PIECE_LIST_SIZE pieces of that type
+    bool place(PieceColor color, PieceType type, Coord location) {
+        if(type == PAWN && (location.rank == 1 || location.rank == 8)) return false;
+        if(remaining[color][type].full()) return false;
+
+        board[location.rank][location.file] = PIECE_CODE(color, type);
+        remaining[color][type].push_back(location);
+        return true;
+    }
+
+    // compute the keys of the position set up with place() and states[0] (later keys are updated incrementally) and detect
+    // dead draws - the last step of setting up a position
+    void finishSetup() {
+        states[0].key = computeHash();
+        states[0].material = computeMaterial();
+        if(insufficientMaterial()) result = GameResult::DRAW_BY_INSUFFICIENT_MATERIAL;
+    }
+
+    // writes the FEN description of the current position into `buffer` (at least FEN_SIZE bytes) and returns it
+    char * toFen(char * buffer) const {
+        const GameState& state = states[ply];
+        char * s = buffer;
+
+        // piece placement
+        for(Rank rank = 8; rank >= 1; rank--) {
+            int empty = 0;
+            for(File file = File::A; file <= File::H; file++) {
+                const Square square = board[rank][file];
+                if(!square) {
+                    empty++;
+                    continue;
+                }
+                if(empty) *s++ = '0' + empty;
+                empty = 0;
+                *s++ = "PNBRQKpnbrqk"[square - 1];
+            }
+            if(empty) *s++ = '0' + empty;
+            if(rank > 1) *s++ = '/';
+        }
+
+        // side to play
+        *s++ = ' ';
+        *s++ = "wb"[toPlay];
 
-        // update state
-        states.push(state);
+        // castling rights
+        *s++ = ' ';
+        const char * rights = s;
+        if(state.canCastle[WHITE][Side::KING]) *s++ = 'K';
+        if(state.canCastle[WHITE][Side::QUEEN]) *s++ = 'Q';
+        if(state.canCastle[BLACK][Side::KING]) *s++ = 'k';
+        if(state.canCastle[BLACK][Side::QUEEN]) *s++ = 'q';
+        if(s == rights) *s++ = '-';
+
+        // passant target square (the square behind the candidate)
+        *s++ = ' ';
+        if(state.passant) {
+            *s++ = '`' + state.passant;
+            *s++ = toPlay ? '3' : '6';
+        } else *s++ = '-';
+
+        // half and full move counters
+        sprintf(s, " %u %u", (unsigned int) state.plies, fullmoves);
+        return buffer;
+    }
 
-        // load position Zobrist key into positions list
-        occurences[hash()] = 1;
+    // returns the FEN description of the current position
+    std::string toFen() const {
+        char buffer[FEN_SIZE];
+        return toFen(buffer);
     }
 
     // returns a list of all pseudolegal moves for color `color`
     std::list<Move> getPseudoLegalMoves(PieceColor color) {
         std::list<Move> moves;
 
-        Board& board = *this;
-
         // non-ranged pieces
         for (PieceType pieceType : {PieceType::PAWN, PieceType::KNIGHT, PieceType::KING}) {
-            for (Piece* piece : remaining[color][pieceType]) {
+            for (Coord from : remaining[color][pieceType]) {
                 for (const CoordOffset& offset : PIECE_OFFSETS[color].at(pieceType)) {
                     Move move;
-                    move.from = piece->location;
-                    move.to = piece->location + offset;
+                    move.from = from;
+                    move.to = from + offset;
 
                     if (!onBoard(move.to)) continue;
-                    move.piece = piece;
-                    move.capture = board[move.to];
 
                     // add move and all move variants (i.e. alternative promotions) to candidate list
-                    if(piece->type == PieceType::PAWN && move.to.rank == RANK(color, 8)) {
+                    if(pieceType == PieceType::PAWN && move.to.rank == RANK(color, 8)) {
                         for(uint8_t promoteTo = PieceType::KNIGHT; promoteTo <= PieceType::QUEEN; promoteTo++) {
                             move.promoteTo = (PieceType) promoteTo;
                             if(pseudoLegal(color, move)) moves.push_back(move);
@@ -369,23 +341,20 @@ public:
             }
         }
 
-        // ranged pieces (variable range)
+        // ranged pieces (variable range) - rooks use the first four directions, bishops the last four and queens all eight
         for (PieceType pieceType : {PieceType::ROOK, PieceType::BISHOP, PieceType::QUEEN}) {
-            for (Piece* piece : remaining[color][pieceType]) {
-                for (Range& range : PIECE_RANGES[pieceType]) {
-                    while (range.hasNext()) {
+            const int first = (pieceType == PieceType::BISHOP) ? 4 : 0;
+            const int last = (pieceType == PieceType::ROOK) ? 4 : 8;
+            for (Coord from : remaining[color][pieceType]) {
+                for (int i = first; i < last; i++) {
+                    for (Coord to = from + DIRECTIONS[i]; onBoard(to); to = to + DIRECTIONS[i]) {
                         Move move;
-                        move.from = piece->location;
-                        move.to = piece->location + range.next();
-
-                        if (!onBoard(move.to)) break;
-                        move.piece = piece;
-                        move.capture = board[move.to];
+                        move.from = from;
+                        move.to = to;
 
                         if(pseudoLegal(color, move)) moves.push_back(move);
-                        if (board[move.to]) break;
+                        if (board[to.rank][to.file]) break;
                     }
-                    range.reset();
                 }
             }
         }
@@ -404,98 +373,150 @@ public:
     // (theoretically slows down the evaluation but makes debugging easier)
     std::list<Move> getAlgebraicMoves(PieceColor color) {
         std::list<Move> moves = getLegalMoves(color);
-        for (Move& move : moves) {
-            std::string algebraic = toAlgebraic(move);
-            move.algebraic = (char *) malloc(algebraic.length() + 1);
-            strcpy(move.algebraic, algebraic.c_str());
-        }
+        for (Move& move : moves) toAlgebraic(move, move.algebraic, &moves);
         return moves;
     }
 
-    // Returns whether or not a square is being attacked by a piece owned by `color` (Note: an 'attack' as defined by FIDE
-    // does not depend on the ability for the attacking piece to capture a piece on that square. For example, a piece pinned
-    // to its king is still said to be 'attacking' the squares it would otherwise be able to capture on had it not been pinned 
-    // (FIDE Handbook E. 3.1.2).
-    bool isAttacked(PieceColor color, Coord location) const {
-        Board& board = (Board&)*this;
-
-        // king
-        for(const CoordOffset offset : PIECE_OFFSETS[color].at(PieceType::KING)) {
-            if(abs(offset.dfile) > 1) continue; // king can't castle into a capture
-            Coord coord = location + offset;
-            if (!onBoard(coord) || !board[coord]) continue;
-
-            const Piece& piece = *board[coord];
-            if (piece.color == color && piece.type == PieceType::KING) return true;
-        }
-
+    // Returns the square of the least valuable piece owned by `color` that attacks `location` on `squares` (a board
+    // representation that may differ from the board's, e.g. with the pieces of an exchange removed), or a square on file
+    // NONE if there is none. If `any` is set, the first attacker found is returned instead
+    static Coord attacker(const Square (&squares)[9][9], PieceColor color, Coord location, bool any = false) {
         // pawns
         if (color ? (location.rank < 7) : (location.rank > 2)) {
             Rank rank = color ? (location.rank + 1) : (location.rank - 1);
             File file = location.file;
-            if (file > A) {
-                const Square& square = this->board[rank][file - 1];
-                if (square && square->color == color && square->type == PAWN) return true;
-            }
-            if (file < H) {
-                const Square& square = this->board[rank][file + 1];
-                if (square && square->color == color && square->type == PAWN) return true;
-            }
+            if (file > A && squares[rank][file - 1] == PIECE_CODE(color, PAWN)) return {file + -1, rank};
+            if (file < H && squares[rank][file + 1] == PIECE_CODE(color, PAWN)) return {file + 1, rank};
         }
 
         // knights
         for (const CoordOffset offset : PIECE_OFFSETS[color].at(PieceType::KNIGHT)) {
             Coord coord = location + offset;
-            if (!onBoard(coord) || !board[coord]) continue;
-
-            const Piece& piece = *board[coord];
-            if (piece.color == color && piece.type == PieceType::KNIGHT) return true;
+            if (onBoard(coord) && squares[coord.rank][coord.file] == PIECE_CODE(color, PieceType::KNIGHT)) return coord;
         }
 
-        // ranged pieces
+        // ranged pieces (the first piece in each direction)
+        Coord sliders[3] = {{File::NONE, 0}, {File::NONE, 0}, {File::NONE, 0}}; // bishop, rook and queen attackers
         for (int i = 0; i < 8; i++) {
-            Range range = ((std::map<PieceType, std::vector<Range>>) PIECE_RANGES)[PieceType::QUEEN][i];
-            while (range.hasNext()) {
-                Coord coord = location + range.next();
-                if (!onBoard(coord)) break;
-                Square& square = board[coord];
-                if (square) {
-                    PieceType type = (i / 4) ? PieceType::BISHOP : PieceType::ROOK;
-                    Piece& piece = *square;
-                    if (piece.color != color) break;
-                    if (piece.type == PieceType::QUEEN || square->type == type) return true;
-                    break;
-                }
+            const PieceType type = (i < 4) ? PieceType::ROOK : PieceType::BISHOP;
+            for (Coord coord = location + DIRECTIONS[i]; onBoard(coord); coord = coord + DIRECTIONS[i]) {
+                const Square square = squares[coord.rank][coord.file];
+                if (!square) continue;
+                if (square == PIECE_CODE(color, type)) sliders[type - PieceType::BISHOP] = coord;
+                else if (square == PIECE_CODE(color, PieceType::QUEEN)) sliders[2] = coord;
+                else break;
+                if (any) return coord;
+                break;
             }
-            range.reset();
         }
+        for (Coord coord : sliders) if (coord.file != File::NONE) return coord;
 
-        return false;
+        // king
+        for(const CoordOffset offset : PIECE_OFFSETS[color].at(PieceType::KING)) {
+            if(abs(offset.dfile) > 1) continue; // king can't castle into a capture
+            Coord coord = location + offset;
+            if (onBoard(coord) && squares[coord.rank][coord.file] == PIECE_CODE(color, PieceType::KING)) return coord;
+        }
+
+        return {File::NONE, 0};
+    }
+
+    // Returns whether or not a square is being attacked by a piece owned by `color` (Note: an 'attack' as defined by FIDE
+    // does not depend on the ability for the attacking piece to capture a piece on that square. For example, a piece pinned
+    // to its king is still said to be 'attacking' the squares it would otherwise be able to capture on had it not been pinned 
+    // (FIDE Handbook E. 3.1.2).
+    bool isAttacked(PieceColor color, Coord location) const {
+        return attacker(board, color, location, true).file != File::NONE;
+    }
+
+    // Static exchange evaluation: the material `move` wins (in centipawns, negative if it loses material) once every
+    // capture on its target square has been played out, least valuable attackers first and with either side free to stop
+    // capturing. Attackers behind the pieces that have captured (x-rays) join the exchange as the squares in front of them
+    // are emptied. Pins are ignored, and a king capturing into an attack loses its (prohibitive) value
+    int see(const Move& move) const {
+        if (move.moveType == MoveType::CASTLE) return 0;
+
+        Square squares[9][9];
+        memcpy(squares, board, sizeof(squares));
+
+        // gain[i] is the material balance (from the point of view of the side making capture i) if the exchange stopped there
+        int gain[34];
+        gain[0] = (move.captureType != CaptureType::NONE) ? PIECE_VALUES[move.capture.type] : 0;
+        PieceType onSquare = move.piece.type; // the piece that stands on the target square (and can be captured next)
+        if (move.moveType == MoveType::PROMOTION) {
+            gain[0] += PIECE_VALUES[move.promoteTo] - PIECE_VALUES[PAWN];
+            onSquare = move.promoteTo;
+        }
+        squares[move.from.rank][move.from.file] = EMPTY;
+        if (move.captureType == CaptureType::EN_PASSANT) squares[move.from.rank][move.to.file] = EMPTY;
+
+        PieceColor color = !move.piece.color;
+        int n = 0;
+        while (n < 32) {
+            // speculative gain of the next capture (only counts if there is a piece to make it), which can't change the
+            // result once neither side can improve on stopping the exchange
+            n++;
+            gain[n] = PIECE_VALUES[onSquare] - gain[n - 1];
+            if (std::max(-gain[n - 1], gain[n]) < 0) break;
+
+            const Coord from = attacker(squares, color, move.to);
+            if (from.file == File::NONE) break;
+            onSquare = PIECE_TYPE(squares[from.rank][from.file]);
+            squares[from.rank][from.file] = EMPTY;
+            color = !color;
+        }
+
+        // negamax the gains back to the first capture (either side can stop capturing)
+        while (--n) gain[n - 1] = -std::max(-gain[n - 1], gain[n]);
+        return gain[0];
     }
 
     // returns whether or not the king of color `color` is in check
     bool inCheck(PieceColor color) const {
-        const Piece * king = remaining[color].at(PieceType::KING).front();
+        return isAttacked(!color, remaining[color][PieceType::KING].front());
+    }
+
+    // returns the current board state
+    const GameState& state() const {
+        return states[ply];
+    }
 
-        return isAttacked(!color, king->location);
+    // returns how many times the current position has been reached, looking back until the last irreversible move
+    int repetitions() const {
+        const GameState& current = states[ply];
+        int n = 1;
+        for(int i = ply - 2; i >= 0 && i >= ply - current.plies; i -= 2)
+            if(states[i].key == current.key) n++;
+        return n;
     }
 
     // execute a move (assumes valid input)
     void move(PieceColor color, Move& move) {
-        GameState state = states.top();
+        const GameState& previous = states[ply];
+        GameState& state = states[ply + 1];
+        state = previous;
+        state.moved = board[move.from.rank][move.from.file];
+        state.promoted = (move.moveType == MoveType::PROMOTION) ? PIECE_CODE(color, move.promoteTo) : EMPTY;
+        state.captured = EMPTY;
+        state.enPassant = move.captureType == CaptureType::EN_PASSANT;
+        state.from = move.from;
+        state.to = move.to;
+
         const Rank rank = move.from.rank;
         const File file = move.from.file;
         const Rank rankPrime = move.to.rank;
         const File filePrime = move.to.file;
         Square& source = board[rank][file];
         Square& target = board[rankPrime][filePrime];
+        const PieceType type = PIECE_TYPE(source);
+        ZobristHash key = previous.key ^ ZOBRIST.blackToPlay;
 
         // check for checkmate or stalemate
         if (move.mate) result = move.check ? (color ? GameResult::BLACK_WINS : GameResult::WHITE_WINS) : GameResult::DRAW_BY_STALEMATE;
 
         // handle castling logic
         if (state.canCastle[color][Side::QUEEN] || state.canCastle[color][Side::KING]) {
-            switch (source->type) {
+            switch (type) {
             case PieceType::KING: {
                 // the king has lost castling rights
                 state.canCastle[color][Side::QUEEN] = false;
@@ -504,14 +525,13 @@ public:
                 // if castling
                 if (move.moveType == MoveType::CASTLE) {
                     // also move rook
-                    int8_t dfile = filePrime - file;
-                    int8_t df = dfile / abs(dfile);
                     Side side = (Side) ((filePrime - 1) / 4); // A - D => queenside, E - H => kingside
-                    Square& rookSource = board[rank][side ? File::H : File::A];
-                    Square& rookTarget = board[rank][side ? File::F : File::D];
-                    rookSource->location.file = side ? File::F : File::D;
-                    rookTarget = rookSource;
-                    rookSource = NULL;
+                    const Coord rookFrom = {side ? File::H : File::A, rank};
+                    const Coord rookTo = {side ? File::F : File::D, rank};
+                    (*this)[rookTo] = (*this)[rookFrom];
+                    (*this)[rookFrom] = EMPTY;
+                    remaining[color][ROOK].replace(rookFrom, rookTo);
+                    key ^= ZOBRIST.pieces[color][ROOK][rank][rookFrom.file] ^ ZOBRIST.pieces[color][ROOK][rank][rookTo.file];
                 }
                 break;
             }
@@ -522,155 +542,149 @@ public:
                     else if (file == File::H) state.canCastle[color][Side::KING] = false;
                 }
                 break;
+            default:
+                break;
             }
         }
 
         // remove previous en passant candidate
-        state.passant = (Piece *) NULL;
-
-        // handle special pawn moves (pawn promotion and moving foward two squares)
-        if (source->type == PieceType::PAWN) {
-            if (move.moveType == MoveType::PROMOTION) {
-                source->type = move.promoteTo; // promote the piece copy
-                remaining[color][PAWN].remove(source); // remove piece from remaining pawns list
-                remaining[color][source->type].push_back(source); // add promoted piece to corresponding remaining list
-            } else if (color ? (rank == rankPrime + 2) : (rank + 2 == rankPrime))
-                state.passant = source;
-        }
+        state.passant = File::NONE;
+
+        // a pawn moving forward two squares becomes the en passant candidate
+        if (type == PieceType::PAWN && (color ? (rank == rankPrime + 2) : (rank + 2 == rankPrime))) state.passant = file;
 
         // execute capture(s)
         if (move.captureType == CaptureType::EN_PASSANT) {
-            Square& passantSquare = board[rank][filePrime];
-            Piece * piece = (Piece *) passantSquare;
-            remaining[piece->color][piece->type].remove(piece); // remove piece from piece list
-            captured[piece->color][piece->type].push_back(piece); // add piece copy to list of captured pieces
-            passantSquare = (Piece*) NULL; // clear passant square
+            state.captured = board[rank][filePrime];
+            state.material -= MATERIAL_PIECE(!color, PAWN);
+            board[rank][filePrime] = EMPTY; // clear passant square
+            remaining[!color][PAWN].remove({filePrime, rank});
+            key ^= ZOBRIST.pieces[!color][PAWN][rank][filePrime];
         } else if (move.captureType == CaptureType::NORMAL) {
-            Piece * piece = target;
-            if(piece->type == ROOK && piece->location.rank == RANK(piece->color, 1)) {
-                if(piece->location.file == A) state.canCastle[piece->color][Side::QUEEN] = false;
-                else if(piece->location.file == H) state.canCastle[piece->color][Side::KING] = false;
+            const PieceType captured = PIECE_TYPE(target);
+            if(captured == ROOK && rankPrime == RANK(!color, 1)) {
+                if(filePrime == A) state.canCastle[!color][Side::QUEEN] = false;
+                else if(filePrime == H) state.canCastle[!color][Side::KING] = false;
             }
-            remaining[piece->color][piece->type].remove(piece);
-            captured[piece->color][piece->type].push_back(piece);
+            state.captured = target;
+            state.material -= MATERIAL_PIECE(!color, captured);
+            remaining[!color][captured].remove(move.to);
+            key ^= ZOBRIST.pieces[!color][captured][rankPrime][filePrime];
+        }
+
+        // move source piece to target square (replacing a promoted pawn with the piece it promotes to)
+        if (move.moveType == MoveType::PROMOTION) {
+            remaining[color][PAWN].remove(move.from);
+            remaining[color][move.promoteTo].push_back(move.to);
+            state.material += MATERIAL_PIECE(color, move.promoteTo) - MATERIAL_PIECE(color, PAWN);
+            target = PIECE_CODE(color, move.promoteTo);
+        } else {
+            remaining[color][type].replace(move.from, move.to);
+            target = source;
         }
+        source = EMPTY;
+        key ^= ZOBRIST.pieces[color][type][rank][file] ^ ZOBRIST.pieces[color][PIECE_TYPE(target)][rankPrime][filePrime];
 
-        // move source piece to target square
-        source->location = move.to;
-        target = source;
-        source = NULL;
+        // update the key for changed castling rights and en passant candidates
+        for(PieceColor c : {WHITE, BLACK})
+            for(Side side : {Side::QUEEN, Side::KING})
+                if(state.canCastle[c][side] != previous.canCastle[c][side]) key ^= ZOBRIST.castling[c][side];
+        key ^= ZOBRIST.passant[previous.passant] ^ ZOBRIST.passant[state.passant];
+        state.key = key;
 
         // check for draw by 50-move rule
-        if(move.piece->type == PAWN || move.captureType != CaptureType::NONE) state.plies = 0;
-        else if(++state.plies >= 100) result = GameResult::DRAW_BY_50_MOVE_RULE;
+        if(type == PAWN || move.captureType != CaptureType::NONE) state.plies = 0;
+        else if(state.plies < UINT8_MAX && ++state.plies >= 100) result = GameResult::DRAW_BY_50_MOVE_RULE;
 
-        // push move info and board state to their respective data structures
-        moves.push_back(move);
-        states.push(state);
+        // advance to the new state
+        ply++;
 
         // update side to play variable
         toPlay = !toPlay;
+        if(color == BLACK) fullmoves++;
 
         // check for draw by repetition
-        ZobristHash zobristKey = hash();
-        if(++occurences[zobristKey] >= 3) result = GameResult::DRAW_BY_REPETITION;
-    }
+        if(repetitions() >= 3) result = GameResult::DRAW_BY_REPETITION;
 
-    // undo a move (temporarily assumes that `move` is on the top of the `moves` stack)
-    void unmove(Move& move) {
-        Piece * piece = move.piece;
-        Piece * capturedPiece = move.capture;
-        PieceColor color = !piece->color;
+        // check for a dead draw (only captures and promotions change the material)
+        if((state.captured || state.promoted) && result == GameResult::IN_PROGRESS && insufficientMaterial())
+            result = GameResult::DRAW_BY_INSUFFICIENT_MATERIAL;
+    }
 
-        // decrement position repetition count
-        ZobristHash zobristKey = hash();
-        if(occurences[zobristKey] > 0) occurences[zobristKey]--;
+    // undo a move (assumes that `move` was the last move made)
+    void unmove(const Move& move) {
+        const PieceColor color = move.piece.color;
+        const PieceType type = move.piece.type;
+        const Square captured = states[ply].captured;
 
         // undo game-ending changes
         result = GameResult::IN_PROGRESS;
 
-        // undo piece capture(s)
-        if (move.captureType != CaptureType::NONE) {
-            const PieceType type = capturedPiece->type;
-            captured[color][type].remove(capturedPiece);
-            remaining[color][type].push_back(capturedPiece);
-            (*this)[capturedPiece->location] = capturedPiece;
-        }
-
-        switch(move.moveType) {
-        // undo a pawn promotion
-        case MoveType::PROMOTION: {
-            // remove the promoted piece from remaining list
-            remaining[piece->color][piece->type].remove(piece);
+        // move piece back to its original square (undoing a pawn promotion)
+        if(move.moveType == MoveType::PROMOTION) {
+            remaining[color][move.promoteTo].remove(move.to);
+            remaining[color][PAWN].push_back(move.from);
+        } else remaining[color][type].replace(move.to, move.from);
+        (*this)[move.from] = PIECE_CODE(color, type);
+        (*this)[move.to] = EMPTY;
 
-            // undo promotion
-            piece->type = PieceType::PAWN;
-            
-            // reinsert the pawn into the remaining pawns lists
-            remaining[piece->color][PieceType::PAWN].push_back(piece);
-            break;
-        }
-        
         // if move is a castling move, then also move the rook back to its original square
-        case MoveType::CASTLE:
-            switch (move.to.file) {
-                case File::C: // O-O-O
-                board[move.from.rank][File::D]->location.file = File::A;
-                board[move.from.rank][File::A] = board[move.from.rank][File::D];
-                board[move.from.rank][File::D] = NULL;
-                break;
-                case File::G: // O-O
-                board[move.from.rank][File::F]->location.file = File::H;
-                board[move.from.rank][File::H] = board[move.from.rank][File::F];
-                board[move.from.rank][File::F] = NULL;
-            }
+        if(move.moveType == MoveType::CASTLE) {
+            const Coord rookFrom = {(move.to.file == File::G) ? File::H : File::A, move.from.rank};
+            const Coord rookTo = {(move.to.file == File::G) ? File::F : File::D, move.from.rank};
+            (*this)[rookFrom] = (*this)[rookTo];
+            (*this)[rookTo] = EMPTY;
+            remaining[color][ROOK].replace(rookTo, rookFrom);
         }
 
-        // move piece back to its original square
-        (*this)[move.from] = piece;
-        piece->location = move.from;
-        if(move.captureType != CaptureType::NORMAL) (*this)[move.to] = NULL;
+        // undo piece capture(s)
+        if (captured) {
+            const Coord location = (move.captureType == CaptureType::EN_PASSANT) ? Coord{move.to.file, move.from.rank} : move.to;
+            (*this)[location] = captured;
+            remaining[PIECE_COLOR(captured)][PIECE_TYPE(captured)].push_back(location);
+        }
 
-        // remove the move from move list
-        moves.pop_back();
-        states.pop();
+        // return to the previous state
+        ply--;
 
         // update side to play variable
         toPlay = !toPlay;
+        if(color == BLACK) fullmoves--;
     }
 
     // fills move struct and returns whether move is pseudo-legal
     bool pseudoLegal(PieceColor color, Move& move) {
-        GameState& state = states.top();
+        // in bounds
+        if (!onBoard(move.from) || !onBoard(move.to)) return false;
+
+        const GameState& state = states[ply];
         const Rank rank = move.from.rank;
         const File file = move.from.file;
         const Rank rankPrime = move.to.rank;
         const File filePrime = move.to.file;
-        Square& source = board[rank][file];
-        Square& target = board[rankPrime][filePrime];
-        Piece * piece = source;
+        const Square source = board[rank][file];
+        const Square target = board[rankPrime][filePrime];
+
+        // ensure a piece is on the selected square
+        if (!source) return false;
+
+        // ensure player owns piece
+        if (PIECE_COLOR(source) != color) return false;
 
         // fill move struct
-        move.piece = piece;
-        move.capture = target;
+        move.piece = {color, PIECE_TYPE(source), move.from};
+        move.moveType = MoveType::NORMAL;
+        move.captureType = CaptureType::NONE;
 
         // whether the moving piece is a pawn moving two squares
         bool moveTwo = false;
 
-        // in bounds
-        if (!onBoard(move.from) || !onBoard(move.to)) return false;
-
-        // ensure a piece is on the selected square
-        if (!piece) return false;
-
-        // ensure player owns piece
-        if (piece->color != color) return false;
-
         // if target square has a piece on it, then ensure that it's the oponnent's piece and that it's not a king
         // (note: checking for a king shouldn't be strictly necessary but it's a temporary solution to a bug that allowed king captures)
         if (target) {
-            if(color == target->color || target->type == PieceType::KING) return false;
+            if(color == PIECE_COLOR(target) || PIECE_TYPE(target) == PieceType::KING) return false;
             move.captureType = CaptureType::NORMAL;
+            move.capture = {!color, PIECE_TYPE(target), move.to};
         }
 
         int8_t drank = rankPrime - rank; // change in rank
@@ -679,7 +693,7 @@ public:
         int8_t df = dfile ? dfile / abs(dfile) : 0; // normalized change in file
         
         // piece-type-dependent rules
-        switch (piece->type) {
+        switch (move.piece.type) {
         case PieceType::PAWN:
             if (abs(dfile) > 1) return false; // moving by > 1 file
             switch (color) {
@@ -699,10 +713,9 @@ public:
 
                     // check for en passant
                     if(!target) {
-                        Square& passantTarget = board[rank][filePrime];
-                        if (!passantTarget || passantTarget->color == color || !state.passant || (state.passant != passantTarget)) return false;
+                        if (state.passant != filePrime || rank != RANK(color, 5)) return false;
                         move.captureType = CaptureType::EN_PASSANT;
-                        move.capture = passantTarget;
+                        move.capture = {!color, PieceType::PAWN, {filePrime, rank}};
                     }
                 }
                 break;
@@ -721,10 +734,9 @@ public:
 
                     // check for en passant
                     if (!target) {
-                        Square& passantTarget = board[rank][filePrime];
-                        if (!passantTarget || passantTarget->color == color || !state.passant || (state.passant != passantTarget)) return false;
+                        if (state.passant != filePrime || rank != RANK(color, 5)) return false;
                         move.captureType = CaptureType::EN_PASSANT;
-                        move.capture = passantTarget;
+                        move.capture = {!color, PieceType::PAWN, {filePrime, rank}};
                     }
                 }
                 break;
@@ -798,6 +810,9 @@ public:
 
     // checks whether a move is legal and whether or not it is a game-ending move
     bool validate(PieceColor color, Move& move) {
+        // leave room for the move and a reply in the state array
+        if (ply + 2 >= MAX_PLIES) return false;
+
         if (!pseudoLegal(color, move) || !legal(color, move)) return false;
 
         // simulate move
@@ -829,37 +844,121 @@ public:
         return true;
     }
 
-    // returns a Zobrist hash of the current position
+    // returns the Zobrist hash of the current position (maintained incrementally by move())
     uint64_t hash() const {
+        return states[ply].key;
+    }
+
+    // computes the Zobrist hash of the current position from scratch
+    uint64_t computeHash() const {
         uint64_t hash = 0;
 
         // piece positions
         for(Rank rank = 1; rank <= 8; rank++) {
             for(File file = File::A; file <= File::H; file++) {
-                if(board[rank][file]) {
-                    Piece * piece = board[rank][file];
-                    hash ^= zobristPieces[piece->color][piece->type][rank][file];
-                }
+                const Square square = board[rank][file];
+                if(square) hash ^= ZOBRIST.pieces[PIECE_COLOR(square)][PIECE_TYPE(square)][rank][file];
             }
         }
 
         // castling rights
         for(PieceColor color : {WHITE, BLACK})
             for(Side side : {QUEEN, KING})
-                if(states.top().canCastle[color][side])
-                    hash ^= zobristCastling[color][side];
+                if(states[ply].canCastle[color][side])
+                    hash ^= ZOBRIST.castling[color][side];
         
         // en passant square
-        if(states.top().passant) hash ^= zobristPassant[states.top().passant->location.file];
+        if(states[ply].passant) hash ^= ZOBRIST.passant[states[ply].passant];
 
         // side to play
-        if(toPlay == PieceColor::BLACK) hash ^= zobristBlackToPlay;
+        if(toPlay == PieceColor::BLACK) hash ^= ZOBRIST.blackToPlay;
 
         return hash;
     }
 
+    // computes the material key of the current position from scratch
+    MaterialKey computeMaterial() const {
+        MaterialKey key = 0;
+        for(PieceColor color : {WHITE, BLACK})
+            for(PieceType type : {PAWN, KNIGHT, BISHOP, ROOK, PieceType::QUEEN}) key += remaining[color][type].size() * MATERIAL_PIECE(color, type);
+        return key;
+    }
+
+    // whether neither side can checkmate by any sequence of moves: no pawns, rooks or queens, and a single minor piece at
+    // most or only bishops that all stand on squares of the same color
+    bool insufficientMaterial() const {
+        const MaterialKey material = states[ply].material;
+        int minors = 0;
+        for(PieceColor color : {WHITE, BLACK}) {
+            if(MATERIAL_COUNT(material, color, PAWN) || MATERIAL_COUNT(material, color, ROOK) || MATERIAL_COUNT(material, color, PieceType::QUEEN)) return false;
+            minors += MATERIAL_COUNT(material, color, KNIGHT) + MATERIAL_COUNT(material, color, BISHOP);
+        }
+        if(minors <= 1) return true;
+        if(MATERIAL_COUNT(material, WHITE, KNIGHT) || MATERIAL_COUNT(material, BLACK, KNIGHT)) return false;
+
+        const Coord first = remaining[WHITE][BISHOP].empty() ? remaining[BLACK][BISHOP].front() : remaining[WHITE][BISHOP].front();
+        for(PieceColor color : {WHITE, BLACK})
+            for(Coord bishop : remaining[color][BISHOP])
+                if(colors[bishop.rank][bishop.file] != colors[first.rank][first.file]) return false;
+        return true;
+    }
+
+    // evaluate king and pawn versus king endings using the KPK bitbase - returns false for any other material
+    bool evaluateKPK(int& evaluation) const {
+        int pieces[2] = {0, 0};
+        for(PieceColor color : {WHITE, BLACK})
+            for(PieceType type : PIECE_TYPES) if(type != PieceType::KING) pieces[color] += remaining[color][type].size();
+
+        for(PieceColor color : {WHITE, BLACK}) {
+            if(pieces[color] != 1 || pieces[!color] || remaining[color][PAWN].size() != 1) continue;
+
+            const Coord pawn = remaining[color][PAWN].front();
+            const Coord king = remaining[color][PieceType::KING].front();
+            const Coord enemyKing = remaining[!color][PieceType::KING].front();
+
+            evaluation = 0;
+            if(KPK_BITBASE.probe(color, toPlay, TB_SQUARE(king.file, king.rank), TB_SQUARE(pawn.file, pawn.rank), TB_SQUARE(enemyKing.file, enemyKing.rank))) {
+                const int advanced = color ? (7 - pawn.rank) : (pawn.rank - 2);
+                evaluation = KPK_WIN + KPK_RANK_BONUS * advanced;
+                if(color) evaluation = -evaluation;
+            }
+            return true;
+        }
+
+        return false;
+    }
+
+    // evaluate endings with a specialized evaluation (see Ending) - returns false for any other material
+    bool evaluateEnding(const MaterialEntry& material, int& evaluation) const {
+        switch(material.ending) {
+            case Ending::KPK: return evaluateKPK(evaluation);
+            case Ending::KXK: evaluation = evaluateKXK(material); return true;
+            default: return false;
+        }
+    }
+
+    // evaluate mating material versus a bare king
+    int evaluateKXK(const MaterialEntry& material) const {
+        const PieceColor strong = material.strong;
+        const Coord king = remaining[strong][PieceType::KING].front();
+        const Coord bareKing = remaining[!strong][PieceType::KING].front();
+
+        // distance of the bare king from the center (plus its closeness to the nearer corner of the bishop's color with bishop
+        // and knight)
+        int edge = (abs(2 * bareKing.file - 9) + abs(2 * bareKing.rank - 9)) / 2 - 1;
+        if(material.key == (MATERIAL_PIECE(strong, BISHOP) | MATERIAL_PIECE(strong, KNIGHT))) {
+            const Coord bishop = remaining[strong][BISHOP].front();
+            const Rank corner = (colors[bishop.rank][bishop.file] == colors[1][A]) ? 1 : 8; // rank of the corner on file A
+            edge += 2 * (14 - std::min(abs(bareKing.file - A) + abs(bareKing.rank - corner), abs(bareKing.file - H) + abs(bareKing.rank - (9 - corner))));
+        }
+        const int distance = std::max(abs(king.file - bareKing.file), abs(king.rank - bareKing.rank));
+
+        const int evaluation = abs(material.imbalance) + KXK_WIN + KXK_EDGE_BONUS * edge + KXK_CLOSE_BONUS * (7 - distance);
+        return strong ? -evaluation : evaluation;
+    }
+
     // evaluate terminal node
-    int evaluate() {
+    int evaluate(const MaterialEntry& material) {
         // evaluate end of game conditions
         switch(result) {
             case GameResult::DRAW_BY_STALEMATE:
@@ -873,11 +972,33 @@ public:
         
         int evaluation = 0;
 
-        // material evaluation
-        for(PieceType type : PIECE_TYPES) {
-            evaluation += remaining[WHITE].at(type).size() * PIECE_VALUES[type];
-            evaluation -= remaining[BLACK].at(type).size() * PIECE_VALUES[type];
+        // known endings
+        if(evaluateEnding(material, evaluation)) return evaluation;
+
+        // weigh the evaluation terms (the material terms are already weighed by the material entry)
+        int terms[EVAL_TERMS];
+        evaluationTerms(terms);
+        evaluation = material.imbalance;
+        for(int i = TERM_DOUBLED_PAWNS; i < EVAL_TERMS; i++) evaluation += EVAL_WEIGHTS[i] * terms[i];
+
+        // scale down the evaluation of drawish endings (fully once only kings and pawns are left)
+        int scale = material.scale[EVAL_COLOR(evaluation)];
+        if(material.ending == Ending::OPPOSITE_BISHOPS) {
+            const Coord white = remaining[WHITE][BISHOP].front(), black = remaining[BLACK][BISHOP].front();
+            if(colors[white.rank][white.file] != colors[black.rank][black.file]) scale = std::min(scale, SCALE_OPPOSITE_BISHOPS);
         }
+        if(scale != SCALE_NORMAL)
+            evaluation = evaluation * (scale * (MAX_PHASE - material.phase) + SCALE_NORMAL * material.phase) / (SCALE_NORMAL * MAX_PHASE);
+
+        return evaluation;
+    }
+
+    // computes the terms of the heuristic evaluation of the current position
+    void evaluationTerms(int (&terms)[EVAL_TERMS]) {
+        // material evaluation
+        for(PieceType type : {PAWN, KNIGHT, BISHOP, ROOK, PieceType::QUEEN})
+            terms[TERM_PAWNS + (int) type] = (int) remaining[WHITE][type].size() - (int) remaining[BLACK][type].size();
+        terms[TERM_BISHOP_PAIR] = (remaining[WHITE][BISHOP].size() >= 2) - (remaining[BLACK][BISHOP].size() >= 2);
 
         // positional evaluation
         int pawns_on_file[2][10] = {0}; // number of pawns on each file (padded on both sides)
@@ -886,8 +1007,8 @@ public:
 
         // count number of pawns on each file
         for(PieceColor color : {WHITE, BLACK})
-            for(Piece * pawn : remaining[color].at(PAWN))
-                pawns_on_file[color][pawn->location.file]++;
+            for(Coord pawn : remaining[color][PAWN])
+                pawns_on_file[color][pawn.file]++;
 
         for(File file = A; file <= H; file++) {
             // doubled pawns (doubled pawns 0.5, tripled pawns 1.0, etc.)
@@ -899,348 +1020,232 @@ public:
             if(pawns_on_file[BLACK][file] && !pawns_on_file[BLACK][file - 1] && !pawns_on_file[BLACK][file + 1]) isolated_pawns -= pawns_on_file[BLACK][file];
         }
         
-        // evaluate pawn structures
-        evaluation -= 50 * (doubled_pawns + isolated_pawns);
-
-        // evaluate mobility
-        evaluation += 10 * (getPseudoLegalMoves(WHITE).size() - getPseudoLegalMoves(BLACK).size());
+        // pawn structures
+        terms[TERM_DOUBLED_PAWNS] = doubled_pawns;
+        terms[TERM_ISOLATED_PAWNS] = isolated_pawns;
 
-        return evaluation;
+        // mobility
+        terms[TERM_MOBILITY] = (int) getPseudoLegalMoves(WHITE).size() - (int) getPseudoLegalMoves(BLACK).size();
     }
 
-    // evaluate a position using minimax to depth `depth`
-    int evaluatePosition(PieceColor color, int alpha, int beta, unsigned int depth) {
-        // evaluate heuristic node
-        if(depth == 0 || result != GameResult::IN_PROGRESS) return evaluate();
-        
-        // look up a position in the transposition table
-        uint64_t hash = this->hash();
-        Position& position = transpositionTable[hash % NPOSITIONS];
-        if(position.key == hash && position.depth >= depth)
-            return position.evaluation;
-
-        // order moves
-        std::list<Move> moves = getLegalMoves(color);
-        if(position.key == hash) moves.sort([position](const Move& m1, const Move& m2) {
-            return (m1 == position.bestMove || (!(m2 == position.bestMove) && m2.capture == NULL));
-        });
-        else moves.sort([](const Move& m1, const Move& m2) { return (bool) !m2.capture; });
-
-        // evaluate the current position
-        position.bestMove.evaluation = color ? INT_MIN : INT_MAX;
-        int evaluation = 0;
-
-        switch(color) {
-            case WHITE: // maximizing player
-            evaluation = INT_MIN;
-            for(Move& move : moves) {
-                move.evaluation = evaluateMove(move, alpha, beta, depth - 1);
-                if(move.evaluation > evaluation) {
-                    position.bestMove = move;
-                    evaluation = move.evaluation;
-                }
-                if(evaluation >= beta) break;
-                alpha = std::max(alpha, evaluation);
-            }
-            break;
-            case BLACK: // minimizing player
-            evaluation = INT_MAX;
-            for(Move& move : moves) {
-                move.evaluation = evaluateMove(move, alpha, beta, depth - 1);
-                if(move.evaluation < evaluation) {
-                    position.bestMove = move;
-                    evaluation = move.evaluation;
-                }
-                if(evaluation <= alpha) break;
-                beta = std::min(beta, evaluation);
-            }
-            break;
+    // returns whether the piece on `from` attacks the square `target` (regardless of whether the piece is pinned)
+    bool attacks(Coord from, Coord target) const {
+        const Square square = board[from.rank][from.file];
+        const int dfile = target.file - from.file, drank = target.rank - from.rank;
+        if(!square || (!dfile && !drank)) return false;
+
+        switch(PIECE_TYPE(square)) {
+        case PAWN: return abs(dfile) == 1 && drank == (PIECE_COLOR(square) ? -1 : 1);
+        case KNIGHT: return abs(dfile * drank) == 2;
+        case PieceType::KING: return abs(dfile) <= 1 && abs(drank) <= 1;
+        case BISHOP: if(abs(dfile) != abs(drank)) return false; break;
+        case ROOK: if(dfile && drank) return false; break;
+        case PieceType::QUEEN: if(dfile && drank && abs(dfile) != abs(drank)) return false; break;
         }
 
-        // write to transposition table
-        position.key = hash;
-        position.evaluation = evaluation;
-        position.depth = depth;
-
-        return evaluation;
-    }
-    
-    // evaluate a move using a minimax approach
-    int evaluateMove(Move& move, int alpha, int beta, unsigned int depth) {
-        // do move
-        this->move(move.piece->color, move);
-
-        // evaluate resulting position
-        const PieceColor color = move.piece->color;
-        move.evaluation = evaluatePosition(!color, alpha, beta, depth);
-        if(IS_MATE(move.evaluation) && EVAL_COLOR(move.evaluation) == color) color ? move.evaluation++ : move.evaluation--; // if results in checkmate, increment mate counter
-
-        // undo move
-        this->unmove(move);
-
-        // return the evaluation of this move
-        return move.evaluation;
+        // ranged pieces need every square in between to be empty
+        const CoordOffset step = {(int8_t) ((dfile > 0) - (dfile < 0)), (int8_t) ((drank > 0) - (drank < 0))};
+        for(Coord coord = from + step; !(coord == target); coord = coord + step)
+            if(board[coord.rank][coord.file]) return false;
+        return true;
     }
 
-    // returns a list of the 'best' moves in the position for `color` by performing a search to depth `depth`
-    std::vector<Move> bestMoves(PieceColor color, unsigned int depth) {
-        std::vector<Move> bestMoves;
-
-        int bestEvaluation = color ? INT_MAX : INT_MIN;
-        for(Move& move : getLegalMoves(color)) {
-            int evaluation = evaluateMove(move, INT_MIN, INT_MAX, depth - 1);
-            if(BETTER(color, evaluation, bestEvaluation)) {
-                bestMoves.clear();
-                bestMoves.push_back(move);
-                bestEvaluation = evaluation;
-            } else if(evaluation == bestEvaluation) bestMoves.push_back(move);
+    // writes the target square, promotion and check(mate) modifiers of `move` at `s` (terminated) and returns `buffer`
+    static char * finishAlgebraic(const Move& move, char * s, char * buffer) {
+        if(move.moveType == MoveType::CASTLE) s = stpcpy(s, (move.to.file == File::G) ? "O-O" : "O-O-O");
+        else {
+            if(move.captureType != CaptureType::NONE) *s++ = 'x';
+            *s++ = '`' + move.to.file;
+            *s++ = '0' + move.to.rank;
+            if(move.moveType == MoveType::PROMOTION) {
+                *s++ = '=';
+                *s++ = " NBRQ"[move.promoteTo];
+            }
         }
-
-        return bestMoves;
+        if(move.check) *s++ = "+#"[move.mate];
+        *s = '\0';
+        return buffer;
     }
 
-    // returns a randomly-selected move from the list of best moves in the current position
-    Move bestMove(PieceColor color, unsigned int depth) {
-        const std::vector<Move> bestMoves = this->bestMoves(color, depth);
-        Move move = bestMoves.at(std::rand() % bestMoves.size());
-        
-        std::string algebraic = toAlgebraic(move);
-        move.algebraic = (char *) malloc(algebraic.length() + 1);
-        strcpy(move.algebraic, algebraic.c_str());
-
-        return move;
+    // writes the long algebraic notation of `move` into `buffer` (at least MOVE_STRING_SIZE bytes) and returns it
+    char * toLongAlgebraic(const Move& move, char * buffer) const {
+        char * s = buffer;
+        if(move.moveType != MoveType::CASTLE) {
+            if(move.piece.type != PAWN) *s++ = " NBRQK"[move.piece.type];
+            if(move.piece.type != PAWN || move.captureType != CaptureType::NONE) {
+                *s++ = '`' + move.from.file;
+                *s++ = '0' + move.from.rank;
+            }
+        }
+        return finishAlgebraic(move, s, buffer);
     }
 
-    // generates a long algebraic notation string from `move`
-    std::string toLongAlgebraic(Move& move) {
-        std::string moveStr = "";
-
-        if(move.moveType == MoveType::CASTLE) return (move.to.file == File::G) ? "O-O" : "O-O-O";
+    // writes the short algebraic notation of `move` into `buffer` (at least MOVE_STRING_SIZE bytes) and returns it. Source
+    // square info is only added if another piece of the same type attacks the target square and can legally move there,
+    // which is looked up in `legalMoves` when the caller already has the position's legal moves
+    // NOTE: move simplifications (e.g. `Ng1f3` -> `Nf3`) are based on the current position. Use of this function outside of the position from which the move is intended to be played can lead to unpredictable outcomes.
+    char * toAlgebraic(const Move& move, char * buffer, const std::list<Move> * legalMoves = NULL) {
+        const Piece& piece = move.piece;
+        char * s = buffer;
 
-        if(move.piece->type != PAWN) moveStr += " NBRQK"[move.piece->type];
+        if(move.moveType == MoveType::CASTLE) return finishAlgebraic(move, s, buffer);
 
-        if (move.piece->type != PAWN || move.captureType != CaptureType::NONE) {
-            moveStr += ('`' + move.from.file);
-            moveStr += ('0' + move.from.rank);
+        if(piece.type == PAWN) {
+            if(move.captureType != CaptureType::NONE) *s++ = '`' + move.from.file;
+            return finishAlgebraic(move, s, buffer);
         }
+        *s++ = " NBRQK"[piece.type];
+
+        // collect the other pieces of the same type that attack the target square (trying a move reorders the piece lists)
+        Coord others[PIECE_LIST_SIZE];
+        int n = 0;
+        for(Coord other : remaining[piece.color][piece.type])
+            if(!(other == move.from) && attacks(other, move.to)) others[n++] = other;
+
+        bool ambiguous = false, file = false, rank = false; // whether another piece can move to the target square (on the same file/rank)
+        for(int i = 0; i < n; i++) {
+            bool legal = false;
+            if(legalMoves) {
+                for(const Move& candidate : *legalMoves)
+                    if((legal = candidate.from == others[i] && candidate.to == move.to)) break;
+            } else {
+                Move candidate;
+                candidate.from = others[i];
+                candidate.to = move.to;
+                legal = pseudoLegal(piece.color, candidate) && this->legal(piece.color, candidate);
+            }
+            if(!legal) continue;
 
-        if (move.captureType != CaptureType::NONE) moveStr += "x";
-        moveStr += ('`' + move.to.file);
-        moveStr += ('0' + move.to.rank);
-
-        if (move.moveType == MoveType::PROMOTION) {
-            moveStr += "=";
-            moveStr += (" NBRQ")[move.promoteTo];
+            ambiguous = true;
+            file |= others[i].file == move.from.file;
+            rank |= others[i].rank == move.from.rank;
         }
 
-        if (move.check) moveStr += "+#"[move.mate];
-
-        return moveStr;
-    }
-
-    // generates a short algebraic notation string from `move`
-    // NOTE: move simplifications (e.g. `Ng1f3` -> `Nf3`) are based on the current position. Use of this function outside of the position from which the move is intended to be played can lead to unpredictable outcomes.
-    std::string toAlgebraic(Move &move) {
-        std::string moveStr = toLongAlgebraic(move);
-
-        // remove unnecessary source square info
-        if (move.piece->type != PAWN || move.captureType != CaptureType::NONE) {
-            std::list<Move> candidateMoves;
-            for (Move& candidate : getLegalMoves(move.piece->color))
-                if (move.to == candidate.to && move.from != candidate.from && move.piece->type == candidate.piece->type) candidateMoves.push_back(candidate);
-
-            bool rank = false; // whether or not there is rank ambiguity
-            bool file = move.piece->type == PAWN; // whether or not there is file ambiguity
-            for (Move& candidate : candidateMoves) {
-                if (candidate.from.rank == move.from.rank) file = true;
-                if (candidate.from.file == move.from.file) rank = true;
-            }
-            
-            std::string::iterator it = moveStr.begin() + (move.piece->type != PAWN);
-            it = file ? ++it : moveStr.erase(it);
-            if(!rank) moveStr.erase(it);
-        }
+        // prefer the file, then the rank, and use both if neither is unique
+        if(ambiguous && (!file || rank)) *s++ = '`' + move.from.file;
+        if(ambiguous && file) *s++ = '0' + move.from.rank;
 
-        return moveStr;
+        return finishAlgebraic(move, s, buffer);
     }
 
-    // parse algebraic notation string and fill `move`
-    bool parseAlgebraic(PieceColor color, Move& move, std::string moveStr) {
-        const std::regex MOVE("^[KQRBN]?[a-h]?[1-8]?x?[a-h][1-8](=[QRBN])?[#+]?");
+    // parse a move in short or long algebraic notation (e.g. "Nf3", "Ng1f3", "e7e8q" or "O-O") and fill `move` - returns
+    // false unless exactly one legal move matches. Only pieces of the moving type that match the move's disambiguation
+    // (and attack the target square) are tried, so the position's legal moves are never generated
+    bool parseAlgebraic(PieceColor color, Move& move, std::string_view moveStr) {
+        // remove annotations and check(mate) modifiers
+        while(!moveStr.empty() && std::string_view("+#!?").find(moveStr.back()) != std::string_view::npos) moveStr.remove_suffix(1);
+        if(moveStr.size() < 2 || ply + 2 >= MAX_PLIES) return false;
 
         PieceType pieceType = PieceType::PAWN;
+        PieceType promoteTo = PieceType::PAWN;
+        Coord from = {(File) -1, (Rank) -1}; // -1 denotes an indefinite square (e.g. the source square of "Nf3" is unspecified)
+        Coord to;
 
-        move.from = {(File) -1, (Rank) -1}; // -1 denotes an indefinite square (e.g. the source square of "Nf3" is unspecified)
-        move.to = {(File) 0, (Rank) 0};
-
-        // parse move string
-        if (std::regex_match(moveStr, MOVE)) {
-            // remove check(mate) modifiers
-            if (moveStr.ends_with("+") || moveStr.ends_with("#")) moveStr.pop_back();
-            
-            // extract the last two characters
-            std::string token = moveStr.substr(moveStr.length() - 2, 2);
-            moveStr.pop_back();
-            moveStr.pop_back();
-
-            // check for promotion clause (=[QRBN])
-            if (token[0] == '=') {
-                move.moveType = MoveType::PROMOTION;
-                move.promoteTo = (PieceType) std::string(" NBRQ").find(token[1]);
-                if(move.promoteTo == (PieceType) std::string::npos) move.promoteTo = PieceType::PAWN;
+        if(moveStr == "O-O" || moveStr == "0-0" || moveStr == "O-O-O" || moveStr == "0-0-0") {
+            pieceType = PieceType::KING;
+            from = {File::E, RANK(color, 1)};
+            to = {(moveStr.size() == 3) ? File::G : File::C, RANK(color, 1)};
+        } else {
+            // extract piece type (if applicable)
+            const size_t type = std::string_view(" NBRQK").find(moveStr[0]);
+            if(type != std::string_view::npos) {
+                pieceType = (PieceType) type;
+                moveStr.remove_prefix(1);
+            }
 
-                // consume next token
-                token = moveStr.substr(moveStr.length() - 2, 2);
-                moveStr.pop_back();
-                moveStr.pop_back();
+            // check for promotion clause ("=Q", "Q" or, directly after the target square, "q")
+            size_t promotion = std::string_view(" NBRQ").find(moveStr.back());
+            if(promotion == std::string_view::npos && moveStr.size() >= 3 && isdigit(moveStr[moveStr.size() - 2]))
+                promotion = std::string_view(" nbrq").find(moveStr.back());
+            if(promotion != std::string_view::npos) {
+                promoteTo = (PieceType) promotion;
+                moveStr.remove_suffix(1);
+                if(!moveStr.empty() && moveStr.back() == '=') moveStr.remove_suffix(1);
             }
+            if(moveStr.size() < 2) return false;
 
             // parse target square token ([a-h][1-8])
-            move.to.rank = token[1] - '0';
-            move.to.file = (File) (token[0] - '`');
-
-            if (!moveStr.empty()) {
-                // remove capture clause (x)
-                if (moveStr.ends_with("x")) moveStr.pop_back();
-                if (!moveStr.empty()) {
-
-                    // extract piece type (if applicable)
-                    pieceType = (PieceType) std::string(" NBRQK").find(moveStr[0]);
-                    if (pieceType != -1) moveStr = moveStr.substr(1);
-                    else pieceType = PieceType::PAWN;
-
-                    // extract starting square info
-                    switch (moveStr.length()) {
-                    case 2:
-                        move.from.rank = moveStr[1] - '0';
-                        move.from.file = (File) (moveStr[0] - '`');
-                        break;
-                    case 1:
-                        if ('a' <= moveStr[0] && moveStr[0] <= 'h') move.from.file = (File) (moveStr[0] - '`');
-                        if ('1' <= moveStr[0] && moveStr[0] <= '8') move.from.rank = (Rank) (moveStr[0] - '0');
-                        break;
-                    }
-                }
+            const char file = moveStr[moveStr.size() - 2], rank = moveStr.back();
+            if(file < 'a' || file > 'h' || rank < '1' || rank > '8') return false;
+            to = {(File) (file - '`'), (Rank) (rank - '0')};
+            moveStr.remove_suffix(2);
+
+            // extract starting square info (ignoring capture clauses and separators)
+            for(char c : moveStr) {
+                if('a' <= c && c <= 'h') from.file = (File) (c - '`');
+                else if('1' <= c && c <= '8') from.rank = (Rank) (c - '0');
+                else if(c != 'x' && c != ':' && c != '-') return false;
             }
-        } else if (moveStr == "O-O") {
-            pieceType = PieceType::KING;
-            move.from.rank = RANK(color, 1);
-            move.from.file = File::E;
-            move.to.rank = move.from.rank;
-            move.to.file = File::G;
-            move.moveType = MoveType::CASTLE;
-        } else if (moveStr == "O-O-O") {
-            pieceType = PieceType::KING;
-            move.from.rank = RANK(color, 1);
-            move.from.file = File::E;
-            move.to.rank = move.from.rank;
-            move.to.file = File::C;
-            move.moveType = MoveType::CASTLE;
+
+            // pawns only leave their file when capturing, which always names the source file
+            if(pieceType == PAWN && from.file == (File) -1) from.file = to.file;
         }
 
-        // check whether move is legal by searching for all legal moves (temporary solution)
-        std::list<Move> candidates;
-        for (Move candidate : getLegalMoves(color)) {
-            if (move.from.rank != (Rank) -1 && move.from.rank != candidate.from.rank) continue;
-            if (move.from.file != (File) -1 && move.from.file != candidate.from.file) continue;
-            if (move.promoteTo != candidate.promoteTo) continue;
-            if (move.to == candidate.to && candidate.piece->type == pieceType) candidates.push_back(candidate);
+        // collect the squares of the candidate pieces first (trying a move reorders the piece lists)
+        Coord sources[PIECE_LIST_SIZE];
+        int n = 0;
+        for(Coord source : remaining[color][pieceType]) {
+            if(from.file != (File) -1 && from.file != source.file) continue;
+            if(from.rank != (Rank) -1 && from.rank != source.rank) continue;
+            if(pieceType != PAWN && pieceType != PieceType::KING && !attacks(source, to)) continue;
+            sources[n++] = source;
         }
 
-        // make a deep copy of the move
-        if (candidates.size() == 1) {
-            move = candidates.front();
-            move.algebraic = (char *) malloc(moveStr.length() + 1);
-            strcpy(move.algebraic, toAlgebraic(move).c_str());
-            return true;
+        // the move must be legal for exactly one of them
+        int found = -1;
+        for(int i = 0; i < n; i++) {
+            move.from = sources[i];
+            move.to = to;
+            move.promoteTo = promoteTo;
+            if(!pseudoLegal(color, move) || !legal(color, move)) continue;
+            if(found >= 0) return false;
+            found = i;
+        }
+        if(found < 0) return false;
+
+        // refill the move struct if a later candidate was tried after the legal one
+        if(found != n - 1) {
+            move.from = sources[found];
+            move.to = to;
+            move.promoteTo = promoteTo;
+            pseudoLegal(color, move);
+            legal(color, move);
         }
 
-        return false;
+        return true;
     }
 
-    // Parse and execute move in algebraic notation
-    bool parseMove(PieceColor color, std::string moveStr, bool debug) {
-        Move move;
+    // Parse and execute move in algebraic notation (`move` is filled with the move played)
+    bool parseMove(PieceColor color, std::string_view moveStr, Move& move) {
+        // validate the move to find out whether it ends the game
+        if(!parseAlgebraic(color, move, moveStr) || !validate(color, move)) return false;
 
-        if(parseAlgebraic(color, move, moveStr)) {
-            this->move(color, move);
-            return true;
-        }
-        return false;
+        toAlgebraic(move, move.algebraic);
+        this->move(color, move);
+        return true;
     }
 
-    // displays a list of moves played this game
-    void displayMoves() {
+    // displays a list of the moves `moves` played from the board's starting position
+    void displayMoves(const std::vector<Move>& moves) const {
+        char buffer[MOVE_STRING_SIZE];
         int n = 1;
 
-        std::list<Move>::iterator begin = moves.begin();
-        if(!moves.empty() && moves.front().piece->color == PieceColor::BLACK) {
-            if(!moves.front().algebraic) {
-                Move& move = moves.front();
-                std::string algebraic = toLongAlgebraic(move);
-                move.algebraic = (char *) malloc(algebraic.length() + 1);
-                strcpy(move.algebraic, algebraic.c_str());
-            }
-            std::cout << "1... " << moves.front().algebraic << " ";
+        auto begin = moves.begin();
+        if(!moves.empty() && moves.front().piece.color == PieceColor::BLACK) {
+            std::cout << "1... " << (moves.front().algebraic[0] ? moves.front().algebraic : toLongAlgebraic(moves.front(), buffer)) << " ";
             begin++;
             n = 3;
         }
 
-        for (std::list<Move>::iterator m = begin; m != moves.end(); m++) {
-            Move& move = *m;
-            if(!move.algebraic) {
-                std::string algebraic = toLongAlgebraic(move);
-                move.algebraic = (char *) malloc(algebraic.length() + 1);
-                strcpy(move.algebraic, algebraic.c_str());
-            }
+        for (auto m = begin; m != moves.end(); m++) {
+            const Move& move = *m;
 
             bool color = n % 2;
             if (color) std::cout << n / 2 + 1 << ". ";
-            std::cout << (*m).algebraic << " ";
+            std::cout << (move.algebraic[0] ? move.algebraic : toLongAlgebraic(move, buffer)) << " ";
             n++;
         }
 
         std::cout << std::endl;
     }
-
-    // display board (debug: blue = passant candidate, red = castling rights)
-    void display(bool debug = false) {
-        const GameState& state = states.top();
-
-        // clear screen
-        std::cout << "\x1b[0;0H" << "\x1b[0J";
-
-        // print board
-        std::cout << "   a  b  c  d  e  f  g  h\n";
-        for (uint16_t rank = 8; rank >= 1; rank--) {
-            std::cout << rank << " ";
-            for (uint16_t file = 1; file <= 8; file++) {
-                const Coord coord = {(File) file, (Rank) rank};
-                const Square &square = board[rank][file];
-                std::string tile_color = bg[colors[rank][file]];
-                std::string piece_color = square ? fg[square->color] : "";
-                const char * piece = square ? PIECES[square->color][square->type] : " ";
-                if(!moves.empty() && moves.back().from == coord) tile_color = "\x1b[46m";
-                if(!moves.empty() && moves.back().to == coord) tile_color = "\x1b[106m";
-                if(debug) {
-                    if ((rank == 1 || rank == 8) && (file == A || file == H) && state.canCastle[rank == 8][file == H]) tile_color = "\x1b[41m";
-                    if (square && state.passant == square) tile_color = "\x1b[44m";
-                }
-                std::cout << tile_color << " " << piece_color << piece << " \x1b[0m";
-            }
-            std::cout << " " << rank << "\n";
-        }
-        std::cout << "   a  b  c  d  e  f  g  h\n\n";
-
-        if(debug) {
-            uint64_t key = hash();
-            std::cout << "This position has occurred " << (int) occurences[key] << " time(s)\n";
-        }
-        
-        // display moves
-        displayMoves();
-
-        // display check message if in check
-        if (result == GameResult::IN_PROGRESS && inCheck(!toPlay)) std::cout << "Check!\n";
-    }
 };
\ No newline at end of file
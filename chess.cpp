@@ -3,25 +3,96 @@
 #include <getopt.h>
 
 #include "game.h"
+#include "server.h"
 
 int main(int argc, char * argv[]) {
     // default parameters
     unsigned int depth = DEFAULT_DEPTH;
     std::string fenString = "";
     bool debug = false;
-
-    Game game(DEFAULT_DEPTH);
+    int headless = 0;
+    uint64_t seed = DEFAULT_SEED;
+    const char * bookPath = NULL;
+    const char * tablebasePath = NULL;
+    const char * pgnPath = NULL;
+    const char * networkPath = NULL;
+    bool network = false;
+    unsigned int lines = DEFAULT_LINES;
+    int margin = 0;
+    double base = 0, increment = 0;
+    const char * serverPath = NULL;
+    const char * hashPath = NULL;
+    const char * recordPath = NULL;
+    const char * tracePath = NULL;
+    size_t hashSize = 0;
+    int mateMoves = -1;
+    unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
 
     // parse command line arguments
+    const option longOptions[] = {{"headless", no_argument, &headless, 1}, {NULL, 0, NULL, 0}};
     int opt;
-    while((opt = getopt(argc, argv, "dDf")) != -1) {
+    while((opt = getopt_long(argc, argv, "bcdDfghHjmMnNprsStT", longOptions, NULL)) != -1) {
         switch(opt) {
+            case 0: // long option setting a flag
+                break;
+            case 'b':
+                bookPath = argv[optind];
+                break;
+            case 'c':
+                if(sscanf(argv[optind], "%lf+%lf", &base, &increment) < 1 || base <= 0) {
+                    std::cerr << "Invalid time control '" << argv[optind] << "'\n";
+                    return EXIT_FAILURE;
+                }
+                break;
             case 'd':
                 depth = std::stoi(argv[optind]);
                 break;
             case 'D':
                 debug = true;
                 break;
+            case 'g':
+                recordPath = argv[optind];
+                break;
+            case 'h':
+                hashSize = std::stoull(argv[optind]);
+                break;
+            case 'H':
+                hashPath = argv[optind];
+                break;
+            case 'j':
+                threads = std::max(1, std::stoi(argv[optind]));
+                break;
+            case 'm':
+                lines = std::stoi(argv[optind]);
+                break;
+            case 'M':
+                mateMoves = std::max(0, std::stoi(argv[optind]));
+                break;
+            case 'n':
+                networkPath = argv[optind];
+                network = true;
+                break;
+            case 'N':
+                network = true;
+                break;
+            case 'p':
+                pgnPath = argv[optind];
+                break;
+            case 'r':
+                margin = std::stoi(argv[optind]);
+                break;
+            case 's':
+                seed = std::stoull(argv[optind]);
+                break;
+            case 'S':
+                serverPath = argv[optind];
+                break;
+            case 't':
+                tablebasePath = argv[optind];
+                break;
+            case 'T':
+                tracePath = argv[optind];
+                break;
             case 'f':
             {
                 FILE * fp = fopen(argv[optind], "r");
@@ -41,18 +112,93 @@ int main(int argc, char * argv[]) {
             }
             default:
                 std::cerr << "Usage: chess [options]\n";
+                std::cerr << "-b file  : Polyglot opening book for the engine\n";
+                std::cerr << "-c m+s   : play with a clock of <m> minutes per side and an increment of <s> seconds per move\n";
                 std::cerr << "-d depth : engine recursion depth\n";
                 std::cerr << "-f file  : starts game from position in FEN file <file>\n";
-                std::cerr << "-D       : start in debug mode" << std::endl;
+                std::cerr << "-g file  : append the game to the game record file <file> when it ends\n";
+                std::cerr << "-h mb    : transposition table size in MB\n";
+                std::cerr << "-H file  : keep the transposition table in <file> (created with the -h size if missing)\n";
+                std::cerr << "-j n     : number of analysis server workers (default: all cores)\n";
+                std::cerr << "-m lines : number of best lines shown by the moves command in debug mode\n";
+                std::cerr << "-M moves : search the position for a mate in <moves> moves (0: any mate) and exit\n";
+                std::cerr << "-n file  : evaluate positions with the NNUE network in <file>\n";
+                std::cerr << "-N       : evaluate positions with the built-in (material only) NNUE network\n";
+                std::cerr << "-p file  : continues the first game in PGN file <file>\n";
+                std::cerr << "-r cp    : engine chooses randomly between moves within <cp> centipawns of the best (-1: never)\n";
+                std::cerr << "-s seed  : seed for choosing between equally good engine moves\n";
+                std::cerr << "-S path  : run an analysis server on the Unix domain socket <path> (- for stdin/stdout)\n";
+                std::cerr << "-t dir   : endgame tablebase directory (generated with tbgen)\n";
+                std::cerr << "-T file  : write a trace of the engine's last searches to <file> after each of its moves\n";
+                std::cerr << "-D       : start in debug mode\n";
+                std::cerr << "--headless : play without displaying the board (the engine's moves are printed one per line)" << std::endl;
                 return EXIT_FAILURE;
         }
     }
 
     // initialize game with FEN string if provided
-    if(fenString.empty()) game = Game(depth);
-    else game = Game(fenString, depth);
+    Game game(depth);
+    if(!fenString.empty() && !game.setPosition(fenString)) {
+        std::cerr << "invalid FEN text\n";
+        return EXIT_FAILURE;
+    }
+    if(pgnPath && !game.importPgn(pgnPath)) {
+        std::cerr << "Could not import PGN file '" << pgnPath << "'\n";
+        return EXIT_FAILURE;
+    }
+    game.seed(seed);
+    game.setLines(lines);
+    game.setRandomMargin(margin);
+    if(base > 0) game.setClock(Milliseconds((int64_t) (base * 60000)), Milliseconds((int64_t) (increment * 1000)));
+    if(bookPath && !game.openBook(bookPath)) {
+        std::cerr << "Could not open book file '" << bookPath << "'\n";
+        return EXIT_FAILURE;
+    }
+    if(tablebasePath && !game.loadTablebases(tablebasePath)) {
+        std::cerr << "No endgame tables found in '" << tablebasePath << "'\n";
+        return EXIT_FAILURE;
+    }
+
+    if(network && !game.loadNetwork(networkPath)) {
+        std::cerr << "Could not load network file '" << networkPath << "'\n";
+        return EXIT_FAILURE;
+    }
+
+    if(hashSize) game.setHashSize(hashSize);
+    if(hashPath && !game.openHash(hashPath)) {
+        std::cerr << "Could not open hash file '" << hashPath << "'\n";
+        return EXIT_FAILURE;
+    }
+
+    // solve for mate instead of playing
+    if(mateMoves >= 0) return game.solveMate(mateMoves) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    // answer analysis requests instead of playing
+    if(serverPath) {
+        AnalysisServer server(threads);
+        if(!server.configure(game.context(), hashPath)) {
+            std::cerr << "Could not open hash file '" << hashPath << "'\n";
+            return EXIT_FAILURE;
+        }
+        if(strcmp(serverPath, "-")) {
+            if(!server.serve(serverPath)) {
+                std::cerr << "Could not listen on '" << serverPath << "'\n";
+                return EXIT_FAILURE;
+            }
+        } else server.serve();
+        return 0;
+    }
 
     // run game
+    if(tracePath && !game.traceTo(tracePath)) {
+        std::cerr << "Search tracing is disabled in this build\n";
+        return EXIT_FAILURE;
+    }
+    if(recordPath && !game.openRecord(recordPath)) {
+        std::cerr << "Could not open record file '" << recordPath << "'\n";
+        return EXIT_FAILURE;
+    }
+    game.setHeadless(headless);
     game.run(debug);
 
     return 0;
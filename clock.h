@@ -0,0 +1,102 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+
+#include "types.h"
+
+/* game clocks and the engine's time management */
+
+typedef std::chrono::milliseconds Milliseconds;
+typedef std::chrono::steady_clock::time_point Time;
+
+// number of moves the engine assumes it still has to make with its remaining time
+#define MOVES_TO_GO 30
+
+// time kept in reserve on every move (for output and for the search to notice the hard limit)
+#define MOVE_OVERHEAD Milliseconds(50)
+
+// the hard limit is at most this multiple of the soft limit (and never more than a quarter of the remaining time)
+#define HARD_LIMIT_FACTOR 5
+
+// evaluation drop (in centipawns) between iterations that makes the engine think longer
+#define SCORE_DROP 30
+
+// evaluation margin (in centipawns) within which no other root move may come for the best move to be considered dominant
+#define DOMINANCE_MARGIN 150
+
+// a game clock: both sides' remaining time, and an increment added after each move
+class Clock {
+private:
+    Milliseconds remaining[2];
+    Milliseconds increment;
+    Time started;
+
+public:
+    Clock(Milliseconds base, Milliseconds increment) : remaining{base, base}, increment(increment) {}
+
+    // time left on `color`'s clock (not counting the move in progress)
+    Milliseconds left(PieceColor color) const { return remaining[color]; }
+    Milliseconds bonus() const { return increment; }
+
+    // start the clock of the side to play
+    void start() { started = std::chrono::steady_clock::now(); }
+
+    // stop `color`'s clock after a move - returns false if its time ran out
+    bool stop(PieceColor color) {
+        remaining[color] -= std::chrono::duration_cast<Milliseconds>(std::chrono::steady_clock::now() - started);
+        if(remaining[color] < Milliseconds::zero()) return false;
+        remaining[color] += increment;
+        return true;
+    }
+};
+
+/* Allocates the engine's time for one move. The search deepens iteratively and consults the time manager after each
+    iteration: the soft limit (a share of the remaining time plus most of the increment) is stretched when the best move
+    changed or its evaluation dropped, and shrunk when the best move is stable and no other move comes close to it. A new
+    iteration is only started while less than half of the adjusted soft limit has passed, as it would most likely not
+    finish in time. The hard limit bounds the iteration in progress and is enforced by the search itself */
+class TimeManager {
+private:
+    PieceColor color;
+    Time start;
+    Milliseconds soft, hard;
+    Move best; // best move of the previous iteration
+    int evaluation = 0; // evaluation of the previous iteration
+    unsigned int stable = 0; // number of consecutive iterations with the same best move
+    double instability = 0; // decaying count of changes of the best move
+
+public:
+    TimeManager(PieceColor color, Milliseconds remaining, Milliseconds increment) : color(color), start(std::chrono::steady_clock::now()) {
+        const Milliseconds available = std::max(remaining - MOVE_OVERHEAD, Milliseconds(1));
+        hard = std::max(available / 4, Milliseconds(1));
+        soft = std::min(available / MOVES_TO_GO + increment * 3 / 4, hard);
+        hard = std::min(soft * HARD_LIMIT_FACTOR, hard);
+    }
+
+    // time after which the search is aborted
+    Time deadline() const { return start + hard; }
+
+    // update the time allocation after an iteration to depth `depth` found `best` (only moves within DOMINANCE_MARGIN
+    // of it were evaluated exactly, and `alternatives` of these followed it) - returns whether to search another iteration
+    bool next(unsigned int depth, const Move& best, unsigned int alternatives) {
+        double scale = 1;
+
+        if(depth > 1 && !(best == this->best)) {
+            stable = 0;
+            instability += 1;
+        } else stable++;
+        scale *= 1 + instability;
+        instability /= 2;
+
+        // think longer if the position got worse, and less if the best move is stable and clearly better than the rest
+        const int64_t drop = color ? (int64_t) best.evaluation - evaluation : (int64_t) evaluation - best.evaluation;
+        if(depth > 1 && drop > SCORE_DROP) scale *= 1.5;
+        if(stable >= 2 && !alternatives) scale *= 0.4;
+
+        this->best = best;
+        evaluation = best.evaluation;
+
+        return std::chrono::steady_clock::now() - start < soft * scale / 2;
+    }
+};
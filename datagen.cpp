@@ -0,0 +1,184 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <getopt.h>
+
+#include "packed.h"
+#include "search.h"
+
+/* Training data generator: plays shallow self-play games on every core and writes their quiet positions, labelled with
+    the search score and the game's result, to a packed position file (see packed.h).
+
+    Each worker plays its games on a board and search context of its own. A game starts with a few random legal moves (so
+    that the games diverge) and continues with the best move found by a fixed depth search; it is adjudicated once a side
+    finds a forced mate, or drawn once it gets too long. A position is kept if the side to play isn't in check and the best
+    move is neither a capture nor a promotion, and if its Zobrist key isn't in the duplicate filter. Positions are packed
+    in binary form straight from the board and buffered per worker until the game's result is known.
+*/
+
+// number of plies after which a game is adjudicated a draw
+#define DATAGEN_MAX_PLIES 400
+
+// number of positions a worker collects before appending them to the file
+#define DATAGEN_BATCH 4096
+
+// Zobrist keys of the positions written so far, indexed by their key modulo the number of entries like the transposition
+// table - a key replaces whatever was stored before it, so the filter forgets old positions instead of filling up
+class PositionFilter {
+private:
+    std::unique_ptr<std::atomic<uint64_t>[]> keys;
+    size_t count;
+
+public:
+    PositionFilter(size_t count) : keys(new std::atomic<uint64_t>[count]()), count(count) {}
+
+    // record `key` - returns false if it was already recorded
+    bool insert(ZobristHash key) {
+        return keys[key % count].exchange(key, std::memory_order_relaxed) != key;
+    }
+};
+
+int main(int argc, char * argv[]) {
+    unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+    uint64_t target = 1000000;
+    unsigned int depth = 4;
+    unsigned int randomPlies = 8;
+    uint64_t seed = DEFAULT_SEED;
+    size_t filterSize = 256;
+
+    int opt;
+    while((opt = getopt(argc, argv, "d:f:j:n:r:s:")) != -1) {
+        switch(opt) {
+            case 'd':
+                depth = std::max(1, std::stoi(optarg));
+                break;
+            case 'f':
+                filterSize = std::max(1ULL, std::stoull(optarg));
+                break;
+            case 'j':
+                threads = std::max(1, std::stoi(optarg));
+                break;
+            case 'n':
+                target = std::stoull(optarg);
+                break;
+            case 'r':
+                randomPlies = std::stoi(optarg);
+                break;
+            case 's':
+                seed = std::stoull(optarg);
+                break;
+            default:
+                optind = argc;
+        }
+    }
+    if(optind != argc - 1) {
+        std::cerr << "Usage: datagen [options] file\n";
+        std::cerr << "-d depth   : search depth (default: 4)\n";
+        std::cerr << "-f mb      : size of the duplicate filter in MB (default: 256)\n";
+        std::cerr << "-j threads : number of worker threads (default: all cores)\n";
+        std::cerr << "-n count   : number of positions to write (default: 1000000)\n";
+        std::cerr << "-r plies   : number of random moves at the start of each game (default: 8)\n";
+        std::cerr << "-s seed    : seed for the random moves" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    PackedPositionWriter writer;
+    if(!writer.open(argv[optind])) {
+        std::cerr << "Could not open position file '" << argv[optind] << "'\n";
+        return EXIT_FAILURE;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    PositionFilter filter(filterSize * 1024 * 1024 / sizeof(uint64_t));
+    std::atomic<uint64_t> written(0), games(0), duplicates(0);
+    std::mutex output;
+
+    // append positions to the file (no more than are still needed) - returns false once enough have been written
+    auto flush = [&](std::vector<PackedPosition>& positions) {
+        std::lock_guard<std::mutex> lock(output);
+        const uint64_t count = std::min<uint64_t>(positions.size(), target - std::min(target, written.load()));
+        if(count && !writer.write(positions.data(), count)) {
+            std::cerr << "Could not write to the position file\n";
+            exit(EXIT_FAILURE);
+        }
+        written += count;
+        positions.clear();
+        return written < target;
+    };
+
+    std::vector<std::thread> pool;
+    for(unsigned int thread = 0; thread < threads; thread++) {
+        pool.emplace_back([&, thread]() {
+            Board board;
+            std::unique_ptr<SearchContext> search(new SearchContext());
+            Random random(seed + thread * 0x2545f4914f6cdd1dULL);
+            std::vector<PackedPosition> batch, game;
+
+            while(written < target) {
+                // random opening
+                board.setPosition(STARTING_FEN);
+                for(unsigned int i = 0; i < randomPlies && board.result == GameResult::IN_PROGRESS; i++) {
+                    std::list<Move> moves = board.getLegalMoves(board.toPlay);
+                    std::list<Move>::iterator move = moves.begin();
+                    std::advance(move, random.below(moves.size()));
+                    board.move(board.toPlay, *move);
+                }
+
+                // self-play
+                game.clear();
+                GameResult result = board.result;
+                while(result == GameResult::IN_PROGRESS) {
+                    if(board.ply >= DATAGEN_MAX_PLIES) {
+                        result = GameResult::DRAW_BY_50_MOVE_RULE;
+                        break;
+                    }
+
+                    Line line = search->bestLine(board, board.toPlay, depth);
+                    if(line.moves.empty()) {
+                        // no legal moves left (checkmate or stalemate)
+                        result = board.inCheck(board.toPlay) ? (board.toPlay ? GameResult::WHITE_WINS : GameResult::BLACK_WINS) : GameResult::DRAW_BY_STALEMATE;
+                        break;
+                    }
+                    Move& move = line.moves.front();
+                    if(IS_MATE(line.evaluation)) {
+                        result = EVAL_COLOR(line.evaluation) ? GameResult::BLACK_WINS : GameResult::WHITE_WINS;
+                        break;
+                    }
+
+                    if(!board.inCheck(board.toPlay) && move.captureType == CaptureType::NONE && move.moveType != MoveType::PROMOTION) {
+                        if(filter.insert(board.hash())) {
+                            game.emplace_back();
+                            game.back().pack(board, line.evaluation, PACKED_DRAW);
+                        } else duplicates++;
+                    }
+
+                    board.move(board.toPlay, move);
+                    result = board.result;
+                }
+                games++;
+
+                // label the positions with the result
+                const uint8_t label = (result == GameResult::WHITE_WINS) ? PACKED_WIN : (result == GameResult::BLACK_WINS) ? PACKED_LOSS : PACKED_DRAW;
+                for(PackedPosition& position : game) position.result = label;
+                batch.insert(batch.end(), game.begin(), game.end());
+                if(batch.size() >= DATAGEN_BATCH && !flush(batch)) break;
+
+                if(thread == 0) {
+                    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                    fprintf(stderr, "\r%lu positions (%.0f/s)", written.load(), written / seconds);
+                }
+            }
+            flush(batch);
+        });
+    }
+    for(std::thread& worker : pool) worker.join();
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("\rpositions:  %lu (%lu duplicates skipped)\n", written.load(), duplicates.load());
+    printf("games:      %lu\n", games.load());
+    printf("time:       %.2fs (%.0f positions/s) on %u threads\n", seconds, written / seconds, threads);
+
+    return 0;
+}
@@ -1,26 +1,190 @@
 #pragma once
 
+#include <cstdio>
 #include <string>
 
 #include "board.h"
+#include "clock.h"
+#include "mate.h"
+#include "pgn.h"
+#include "record.h"
 #include "player.h"
+#include "search.h"
+#include "terminal.h"
 
 class Game {
 private:
     HumanPlayer player1;
     CPUPlayer player2;
     Board board;
+    SearchContext search;
+    std::vector<Move> moves; // moves played since the board's position was set up
+    std::unique_ptr<Clock> clock; // game clock (optional)
+    std::string fen = STARTING_FEN; // starting position of the game
+    GameRecordWriter record; // record file the game is appended to (optional)
+    std::string tracePath; // file the engine's search trace is written to after each of its moves (optional)
+    Terminal terminal;
+    std::string status; // status lines below the board
+    bool headless = false; // whether the board is displayed
+
+    // display the board and the clocks (and, in debug mode, the statistics of the last search)
+    void display(bool debug) {
+        status.clear();
+        if(clock) status.append("White ").append(clockString(clock->left(WHITE))).append("  Black ").append(clockString(clock->left(BLACK))).append("\n");
+        if(debug && search.stats.nodes) status += search.stats.text();
+        terminal.draw(board, moves, status, debug);
+    }
+
+    // formats a clock time as m:ss.s
+    static std::string clockString(Milliseconds time) {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%lld:%04.1f", (long long) (time.count() / 60000), (time.count() % 60000) / 1000.0);
+        return buffer;
+    }
+
 public:
     Game(int depth) : player1(PieceColor::WHITE, depth), player2(PieceColor::BLACK, depth) {}
-    Game(std::string fen, unsigned int depth) : Game(depth) { board = Board(fen); }
+
+    // the engine's configuration (tablebases, network, ...)
+    const SearchContext& context() const { return search; }
+
+    // set up the position described by `fen` - returns false if `fen` is malformed
+    bool setPosition(std::string_view fen) {
+        moves.clear();
+        this->fen = fen;
+        return board.setPosition(fen);
+    }
+
+    // play without displaying the board (the engine's moves are printed instead, one per line)
+    void setHeadless(bool headless) { this->headless = headless; }
+
+    // set the number of best lines shown by the `moves` command in debug mode
+    void setLines(unsigned int lines) { player1.lines = lines; }
+
+    // play with a clock of `base` per side plus `increment` per move (the engine then manages its time instead of searching
+    // to a fixed depth)
+    void setClock(Milliseconds base, Milliseconds increment) {
+        clock = std::make_unique<Clock>(base, increment);
+        player1.clock = player2.clock = clock.get();
+    }
+
+    // seed the generator used by the engine to choose between equally good moves
+    void seed(uint64_t seed) { search.random = Random(seed); }
+
+    // let the engine choose at random between moves within `margin` centipawns of its best move (RANDOM_MARGIN_OFF: never)
+    void setRandomMargin(int margin) { search.randomMargin = margin; }
+
+    // map the endgame tablebases found in `directory` - returns the number of tables loaded
+    size_t loadTablebases(const char * directory) {
+        search.tablebases = std::make_shared<Tablebases>();
+        return search.tablebases->load(directory);
+    }
+
+    // evaluate positions with the neural network in `path` (or the built-in network if `path` is null) - returns false if
+    // the file cannot be loaded
+    bool loadNetwork(const char * path) {
+        std::shared_ptr<Network> network = std::make_shared<Network>();
+        if(path && !network->load(path)) return false;
+        search.setNetwork(network);
+        return true;
+    }
+
+    // use a transposition table of `megabytes` MB
+    void setHashSize(size_t megabytes) { search.transpositionTable.resize(std::max<size_t>(megabytes * 1024 * 1024 / sizeof(Position), 1)); }
+
+    // keep the transposition table in the file at `path` (created if it doesn't exist), so that it persists across
+    // sessions - returns false if the file can't be mapped or was written by an incompatible build
+    bool openHash(const char * path) { return search.transpositionTable.open(path); }
+
+    // append the game to the record file at `path` once it ends - returns false if the file can't be written to
+    bool openRecord(const char * path) { return record.open(path); }
+
+    // trace the engine's searches and write the trace to `path` after each of its moves - returns false if tracing was
+    // compiled out
+    bool traceTo(const char * path) {
+#ifdef NTRACE
+        return false;
+#else
+        search.trace = std::make_unique<SearchTrace>();
+        tracePath = path;
+        return true;
+#endif
+    }
+
+    // load a Polyglot opening book for the engine - returns true upon success
+    bool openBook(const char * path) {
+        std::shared_ptr<Book> book = std::make_shared<Book>(path);
+        if(!book->isOpen()) return false;
+        player2.book = book;
+        return true;
+    }
+
+    // continue from the end of the first game in a PGN file - returns false if the file cannot be read or a move is illegal
+    bool importPgn(const char * path) {
+        PgnFile file(path);
+        std::string_view text = file.text();
+        PgnGame pgn;
+        if(!file.isOpen() || !PgnFile::next(text, pgn)) return false;
+
+        std::string_view fen = pgn.tag("FEN");
+        if(!setPosition(fen.empty() ? STARTING_FEN : fen)) return false;
+
+        // keep the original move text for the move list
+        std::string_view error;
+        return replay(board, pgn, [this](Move& move, std::string_view san) {
+            move.algebraic[san.copy(move.algebraic, MOVE_STRING_SIZE - 1)] = '\0';
+            moves.push_back(move);
+        }, error) >= 0;
+    }
+
+    // search for a mate by the side to play in at most `moves` moves (0: any mate) and display the outcome - returns
+    // whether a mate was found
+    bool solveMate(unsigned int moves) {
+        MateSolver solver;
+        const MateResult result = solver.solve(board, moves);
+        switch(result.status) {
+            case MateStatus::MATE:
+                std::cout << "Mate in " << (result.plies + 1) / 2 << ": ";
+                board.displayMoves(result.line);
+                break;
+            case MateStatus::NO_CHECKING_MATE:
+                if(moves) std::cout << "No mate by checks only in " << moves << "\n";
+                else std::cout << "No mate by checks only\n";
+                break;
+            case MateStatus::UNKNOWN:
+                std::cout << "Gave up\n";
+                break;
+        }
+        std::cout << result.nodes << " nodes in " << result.seconds << "s" << std::endl;
+        return result.status == MateStatus::MATE;
+    }
 
     void run(bool debug = false)  {
-        board.display(debug);
+        if(!headless) display(debug);
 
         // main loop
+        bool flagged = false;
         while(board.result == GameResult::IN_PROGRESS) {
-            board.toPlay ? player2.move(board, debug) : player1.move(board, debug);
-            board.display(debug);
+            Move move;
+            const PieceColor color = board.toPlay;
+            if(clock) clock->start();
+            if(color ? player2.move(board, search, move, debug) : player1.move(board, search, move, debug)) {
+                moves.push_back(move);
+                if(color && headless) std::cout << move.algebraic << std::endl;
+            }
+            if(color && search.trace && !search.trace->dump(tracePath.c_str())) std::cerr << "Could not write the trace file\n";
+            if(clock && !clock->stop(color) && board.result == GameResult::IN_PROGRESS) {
+                board.result = color ? GameResult::WHITE_WINS : GameResult::BLACK_WINS;
+                flagged = true;
+            }
+            if(!headless) display(debug);
+        }
+
+        if(record.isOpen() && !record.write(fen, moves, board.result)) std::cerr << "Could not write the game to the record file\n";
+
+        if(flagged) {
+            std::cout << (board.result == GameResult::WHITE_WINS ? "Black" : "White") << " lost on time!\n";
+            return;
         }
 
         // display game outcome - stalemate is currently the only draw condition and checkmate the only win condition
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "board.h"
+#include "nnue.h"
+
+/* Interleaved search: the nodes of a search are written as coroutines, so that many independent searches can run on one
+    thread. A node suspends right after requesting its transposition table entry from memory, and the scheduler resumes
+    another search meanwhile; by the time the node is resumed the entry is usually in the cache. Shallow searches of
+    many positions spend most of their time waiting for these misses, which the other searches now fill. An ordinary
+    search runs the same nodes in a lane that isn't interleaved, where they never suspend.
+
+    Each search runs in a lane, which has a board and a stack of its own for the coroutine frames: a node's frame is
+    created when its parent awaits it and destroyed when it returns, so the frames of a lane come and go in LIFO order and
+    don't need the heap. Move generation still allocates the nodes of its move lists, which limits what interleaving
+    can gain until it doesn't. */
+
+// number of searches interleaved by default
+#define INTERLEAVE_LANES 8
+
+// size of a lane's coroutine frame stack in bytes (frames that don't fit go on the heap)
+#define FRAME_STACK_SIZE (64 * 1024)
+
+// a stack of coroutine frames
+class FrameStack {
+private:
+    // header in front of each frame: the stack it is on (null if it is on the heap)
+    struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) Header {
+        FrameStack * stack;
+    };
+
+    std::unique_ptr<std::byte[]> memory;
+    size_t top = 0;
+
+    static size_t padded(size_t size) {
+        return (sizeof(Header) + size + __STDCPP_DEFAULT_NEW_ALIGNMENT__ - 1) & ~(__STDCPP_DEFAULT_NEW_ALIGNMENT__ - 1);
+    }
+
+public:
+    FrameStack() : memory(new std::byte[FRAME_STACK_SIZE]) {}
+    FrameStack(const FrameStack&) = delete;
+
+    // allocate a frame of `size` bytes
+    void * push(size_t size) {
+        Header * header;
+        if(top + padded(size) <= FRAME_STACK_SIZE) {
+            header = (Header *) (memory.get() + top);
+            header->stack = this;
+            top += padded(size);
+        } else {
+            header = (Header *) ::operator new(padded(size));
+            header->stack = NULL;
+        }
+        return header + 1;
+    }
+
+    // free the frame of `size` bytes at `frame` (the last one allocated on its stack)
+    static void pop(void * frame, size_t size) {
+        Header * header = (Header *) frame - 1;
+        if(header->stack) header->stack->top -= padded(size);
+        else ::operator delete(header);
+    }
+};
+
+struct SearchLane;
+
+// a node of a search: a coroutine that starts when it is awaited and hands its evaluation to its awaiter
+// when it returns (the root node of a lane, which nobody awaits, returns to the scheduler instead). In a lane that isn't
+// interleaved the awaiter never suspends: the node runs to its end as an ordinary call
+class SearchTask {
+public:
+    struct promise_type {
+        int evaluation = 0;
+        std::coroutine_handle<> awaiter = std::noop_coroutine();
+        bool interleaved; // whether the lane the coroutine runs in is interleaved
+
+        template<typename Context, typename... Args>
+        promise_type(Context&, SearchLane& lane, Args&&...);
+
+        SearchTask get_return_object() { return SearchTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        void return_value(int evaluation) { this->evaluation = evaluation; }
+        void unhandled_exception() { std::terminate(); }
+
+        // continue with the awaiter (symmetric transfer, so that deep searches don't grow the thread's stack)
+        auto final_suspend() noexcept {
+            struct Resume {
+                bool await_ready() noexcept { return false; }
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> task) noexcept { return task.promise().awaiter; }
+                void await_resume() noexcept {}
+            };
+            return Resume();
+        }
+
+        // frames are allocated on the stack of the lane the coroutine (a member function taking the lane first) runs in
+        template<typename Context, typename... Args>
+        static void * operator new(size_t size, Context&, SearchLane& lane, Args&&...);
+        static void operator delete(void * frame, size_t size) { FrameStack::pop(frame, size); }
+    };
+
+    SearchTask() = default;
+    SearchTask(SearchTask&& task) : handle(task.handle) { task.handle = NULL; }
+    SearchTask& operator=(SearchTask&& task) {
+        std::swap(handle, task.handle);
+        return *this;
+    }
+    ~SearchTask() {
+        if(handle) handle.destroy();
+    }
+
+    // whether the coroutine has returned
+    bool done() const { return handle.done(); }
+
+    // the evaluation returned by the coroutine
+    int evaluation() const { return handle.promise().evaluation; }
+
+    // start the coroutine (only for roots - nodes are started by awaiting them)
+    std::coroutine_handle<> start() const { return handle; }
+
+    bool await_ready() const {
+        if(handle.promise().interleaved) return false;
+        handle.resume();
+        return true;
+    }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) {
+        handle.promise().awaiter = awaiter;
+        return handle;
+    }
+    int await_resume() const { return handle.promise().evaluation; }
+
+private:
+    std::coroutine_handle<promise_type> handle = NULL;
+
+    SearchTask(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+};
+
+// where a search runs (one of those interleaved, or a search on its own)
+struct SearchLane {
+    Board * board = NULL; // the position searched
+    FrameStack frames;
+    bool interleaved = false; // whether the lane gives way to the others at transposition table probes
+    std::vector<Accumulator> accumulators; // the network's accumulators (swapped into the search context while the lane runs)
+    SearchTask root; // the search in progress
+    std::coroutine_handle<> suspended; // where the search continues
+    size_t index = 0; // number of the position searched
+    std::vector<Move> candidates; // the best moves found by the search (see SearchContext::rootTask())
+};
+
+template<typename Context, typename... Args>
+SearchTask::promise_type::promise_type(Context&, SearchLane& lane, Args&&...) : interleaved(lane.interleaved) {}
+
+template<typename Context, typename... Args>
+void * SearchTask::promise_type::operator new(size_t size, Context&, SearchLane& lane, Args&&...) {
+    return lane.frames.push(size);
+}
+
+// suspend an interleaved lane once the cache line at `address` is requested from memory, so that the other lanes run
+// while it arrives
+struct Prefetch {
+    const void * address;
+    SearchLane& lane;
+
+    bool await_ready() const {
+        __builtin_prefetch(address);
+        return !lane.interleaved;
+    }
+    void await_suspend(std::coroutine_handle<> node) { lane.suspended = node; }
+    void await_resume() const {}
+};
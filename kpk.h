@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "tablebase.h"
+#include "types.h"
+
+// number of king and pawn versus king positions (side to play x pawn on files a-d, ranks 2-7 x white king x black king)
+#define KPK_POSITIONS (2 * 24 * 64 * 64)
+
+/* King and pawn versus king bitbase: one bit per position recording whether the side with the pawn (always white in the
+   table) wins. Positions are classified by iterating until no position changes, starting from the positions that are
+   decided immediately (a safe promotion, stalemate, or the pawn being lost) */
+class KPKBitbase {
+private:
+    enum Result : uint8_t { INVALID = 0, UNKNOWN = 1, DRAW = 2, WIN = 4 };
+
+    uint32_t bits[KPK_POSITIONS / 32] = {0};
+
+    static unsigned int index(PieceColor toPlay, uint8_t whiteKing, uint8_t blackKing, uint8_t pawn) {
+        return whiteKing | (blackKing << 6) | (toPlay << 12) | (TB_FILE(pawn) << 13) | ((6 - TB_RANK(pawn)) << 15);
+    }
+
+    static int distance(uint8_t s1, uint8_t s2) {
+        return std::max(abs(TB_FILE(s1) - TB_FILE(s2)), abs(TB_RANK(s1) - TB_RANK(s2)));
+    }
+
+    static bool pawnAttacks(uint8_t pawn, uint8_t square) {
+        return TB_RANK(square) == TB_RANK(pawn) + 1 && abs(TB_FILE(square) - TB_FILE(pawn)) == 1;
+    }
+
+    // squares a king on `square` can move to
+    static int kingMoves(uint8_t square, uint8_t * targets) {
+        int n = 0;
+        for(int dr = -1; dr <= 1; dr++) {
+            for(int df = -1; df <= 1; df++) {
+                int rank = TB_RANK(square) + dr, file = TB_FILE(square) + df;
+                if((dr || df) && rank >= 0 && rank < 8 && file >= 0 && file < 8) targets[n++] = 8 * rank + file;
+            }
+        }
+        return n;
+    }
+
+    // classify a position without looking at its successors
+    static Result initial(unsigned int i) {
+        const uint8_t whiteKing = i & 63, blackKing = (i >> 6) & 63;
+        const PieceColor toPlay = (PieceColor) ((i >> 12) & 1);
+        const uint8_t pawn = 8 * (6 - ((i >> 15) & 7)) + ((i >> 13) & 3);
+        const uint8_t promotion = pawn + 8;
+
+        // overlapping pieces, adjacent kings, or the black king in check with white to play
+        if(distance(whiteKing, blackKing) <= 1 || whiteKing == pawn || blackKing == pawn || (toPlay == WHITE && pawnAttacks(pawn, blackKing)))
+            return INVALID;
+
+        // the pawn promotes without being captured
+        if(toPlay == WHITE && TB_RANK(pawn) == 6 && whiteKing != promotion && blackKing != promotion
+           && (distance(blackKing, promotion) > 1 || distance(whiteKing, promotion) == 1))
+            return WIN;
+
+        if(toPlay == BLACK) {
+            // the black king captures the undefended pawn
+            if(distance(blackKing, pawn) == 1 && distance(whiteKing, pawn) > 1) return DRAW;
+
+            // stalemate
+            uint8_t targets[8];
+            bool stalemate = true;
+            for(int m = 0, n = kingMoves(blackKing, targets); m < n && stalemate; m++)
+                stalemate = distance(targets[m], whiteKing) <= 1 || pawnAttacks(pawn, targets[m]);
+            if(stalemate) return DRAW;
+        }
+
+        return UNKNOWN;
+    }
+
+    // classify a position from the results of its successors
+    static Result classify(const std::vector<Result>& results, unsigned int i) {
+        const uint8_t whiteKing = i & 63, blackKing = (i >> 6) & 63;
+        const PieceColor toPlay = (PieceColor) ((i >> 12) & 1);
+        const uint8_t pawn = 8 * (6 - ((i >> 15) & 7)) + ((i >> 13) & 3);
+
+        // the side to play needs one good successor, and the position is bad if every successor is bad
+        const Result good = toPlay ? DRAW : WIN, bad = toPlay ? WIN : DRAW;
+        uint8_t result = INVALID;
+
+        uint8_t targets[8];
+        if(toPlay == WHITE) {
+            for(int m = 0, n = kingMoves(whiteKing, targets); m < n; m++) result |= results[index(BLACK, targets[m], blackKing, pawn)];
+
+            // single and double pawn pushes (promotions are handled when the table is seeded)
+            if(TB_RANK(pawn) < 6) {
+                result |= results[index(BLACK, whiteKing, blackKing, pawn + 8)];
+                if(TB_RANK(pawn) == 1 && pawn + 8 != whiteKing && pawn + 8 != blackKing)
+                    result |= results[index(BLACK, whiteKing, blackKing, pawn + 16)];
+            }
+        } else {
+            for(int m = 0, n = kingMoves(blackKing, targets); m < n; m++) result |= results[index(WHITE, whiteKing, targets[m], pawn)];
+        }
+
+        return (result & good) ? good : (result & UNKNOWN) ? UNKNOWN : bad;
+    }
+
+public:
+    KPKBitbase() {
+        std::vector<Result> results(KPK_POSITIONS);
+        for(unsigned int i = 0; i < KPK_POSITIONS; i++) results[i] = initial(i);
+
+        // iterate until no unknown position can be resolved
+        bool changed = true;
+        while(changed) {
+            changed = false;
+            for(unsigned int i = 0; i < KPK_POSITIONS; i++) {
+                if(results[i] != UNKNOWN) continue;
+                results[i] = classify(results, i);
+                changed |= results[i] != UNKNOWN;
+            }
+        }
+
+        for(unsigned int i = 0; i < KPK_POSITIONS; i++) if(results[i] == WIN) bits[i / 32] |= 1u << (i % 32);
+    }
+
+    // whether the side with the pawn wins (squares are numbered 0-63 as in the tablebases)
+    bool probe(PieceColor strongSide, PieceColor toPlay, uint8_t strongKing, uint8_t pawn, uint8_t weakKing) const {
+        // normalize so that the strong side is white and the pawn is on files a-d
+        if(strongSide == BLACK) {
+            strongKing ^= 56;
+            pawn ^= 56;
+            weakKing ^= 56;
+            toPlay = !toPlay;
+        }
+        if(TB_FILE(pawn) > 3) {
+            strongKing ^= 7;
+            pawn ^= 7;
+            weakKing ^= 7;
+        }
+
+        unsigned int i = index(toPlay, strongKing, weakKing, pawn);
+        return bits[i / 32] & (1u << (i % 32));
+    }
+};
+
+const KPKBitbase KPK_BITBASE;
@@ -0,0 +1,258 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+
+#include "board.h"
+#include "clock.h"
+
+/* Mate solver using depth-first proof-number search (df-pn).
+
+    The side to play at the root is the attacker, who only considers checking moves; the defender considers all of its
+    moves (which are all evasions). A node's proof number is the minimum number of leaves that still have to be proven
+    mates to prove that the attacker mates, and its disproof number the minimum number that still have to be disproven.
+    df-pn always expands the most proving node reachable from the root, but searches depth-first: each subtree is searched
+    until its proof or disproof number exceeds a threshold derived from its siblings, and the numbers of searched nodes are
+    kept in the solver's own hash table. Unlike alpha-beta, the search therefore goes deep along forcing lines without
+    looking at every defence of every line at full width.
+
+    Since the attacker's quiet moves are never tried, a disproof only shows that there is no mate made of checks alone.
+
+    Draws (stalemate, repetition - including the first repetition of a position, to avoid cycles - and the 50 move rule)
+    count as failures to mate. Disproofs that rest on a repetition or the 50 move rule depend on how the position was
+    reached, so their entries are only used along the path that found them, never when the position is reached again.
+    When the number of moves is limited, the number of plies left is part of the hash key. */
+
+// number of entries in the solver's hash table
+#define MATE_TABLE_SIZE (1 << 20)
+
+// proof and disproof number of nodes that are proven or disproven
+#define PN_INFINITY (1u << 30)
+
+// number of nodes between checks of the time limit
+#define MATE_POLL_INTERVAL 4096
+
+// plies left value for searches without a move limit
+#define MATE_UNLIMITED -1
+
+// outcome of a mate search (NO_CHECKING_MATE: no mate made of checks alone, though one with quiet moves may exist)
+enum class MateStatus { MATE, NO_CHECKING_MATE, UNKNOWN };
+
+// outcome of a mate search
+struct MateResult {
+    MateStatus status;
+    unsigned int plies; // length of the mate found (in plies)
+    std::vector<Move> line; // mating line (with algebraic descriptions) - the defence chosen is the longest one proven
+    uint64_t nodes; // nodes expanded
+    double seconds; // time taken
+};
+
+class MateSolver {
+private:
+    struct Entry {
+        ZobristHash key;
+        uint32_t pn, dn;
+        uint32_t distance; // plies to mate (if proven)
+        bool path; // whether the position is disproven by a draw that depends on the path to it
+    };
+
+    // a node's successor
+    struct Child {
+        Move move;
+        ZobristHash key;
+        uint32_t pn, dn, distance;
+        bool terminal; // whether the child's numbers are known without searching it
+        bool path; // whether the child is disproven by a draw that depends on the path to it
+    };
+
+    std::vector<Entry> table;
+    PieceColor attacker;
+    uint64_t nodes;
+    Time deadline;
+    bool stopped;
+
+    // hash table key of the current position with `remaining` plies left
+    static ZobristHash key(const Board& board, int remaining) {
+        return (remaining == MATE_UNLIMITED) ? board.hash() : board.hash() ^ ((uint64_t) (remaining + 1) * 0x9e3779b97f4a7c15ULL);
+    }
+
+    void store(ZobristHash key, uint32_t pn, uint32_t dn, uint32_t distance, bool path = false) { table[key % MATE_TABLE_SIZE] = {key, pn, dn, distance, path}; }
+
+    // generate the successors of the current position (which has `remaining` plies left) and their numbers so far
+    std::vector<Child> expand(Board& board, int remaining) {
+        const bool attacking = board.toPlay == attacker;
+        const int left = (remaining == MATE_UNLIMITED) ? MATE_UNLIMITED : remaining - 1;
+
+        std::vector<Child> children;
+        for(Move& move : board.getLegalMoves(board.toPlay)) {
+            if(attacking && !move.check) continue;
+
+            board.move(board.toPlay, move);
+            Child child = {move, key(board, left), 1, 1, 0, true, false};
+            if(move.mate && move.check) {
+                // checkmate
+                child.pn = attacking ? 0 : PN_INFINITY;
+                child.dn = attacking ? PN_INFINITY : 0;
+            } else if(board.result != GameResult::IN_PROGRESS || board.repetitions() >= 2 || left == 0) {
+                // draws, and positions the attacker can't mate from within the limit
+                child.pn = PN_INFINITY;
+                child.dn = 0;
+                child.path = board.repetitions() >= 2 || board.result == GameResult::DRAW_BY_REPETITION || board.result == GameResult::DRAW_BY_50_MOVE_RULE;
+            } else {
+                // (disproofs that depend on another path to the position don't apply)
+                child.terminal = false;
+                const Entry& entry = table[child.key % MATE_TABLE_SIZE];
+                if(entry.key == child.key && !entry.path) {
+                    child.pn = entry.pn;
+                    child.dn = entry.dn;
+                    child.distance = entry.distance;
+                }
+            }
+            board.unmove(move);
+
+            children.push_back(child);
+        }
+
+        return children;
+    }
+
+    // refresh the numbers of the non-terminal `children` from the hash table (after searching them along the current path)
+    void update(std::vector<Child>& children) const {
+        for(Child& child : children) {
+            if(child.terminal) continue;
+            const Entry& entry = table[child.key % MATE_TABLE_SIZE];
+            if(entry.key != child.key) continue;
+            child.pn = entry.pn;
+            child.dn = entry.dn;
+            child.distance = entry.distance;
+            child.path = entry.path;
+        }
+    }
+
+    // search the current position (with hash key `key` and `remaining` plies left) until its proof number reaches `thpn`
+    // or its disproof number reaches `thdn`
+    void search(Board& board, ZobristHash key, int remaining, uint32_t thpn, uint32_t thdn) {
+        if(++nodes % MATE_POLL_INTERVAL == 0 && std::chrono::steady_clock::now() >= deadline) stopped = true;
+
+        const bool attacking = board.toPlay == attacker;
+        std::vector<Child> children = expand(board, remaining);
+        if(children.empty()) {
+            // no checks left (or no room left in the board's state array)
+            store(key, PN_INFINITY, 0, 0);
+            return;
+        }
+
+        while(true) {
+            // the attacker needs one child proven and all children disproven, the defender the opposite
+            uint64_t pn = attacking ? PN_INFINITY : 0, dn = attacking ? 0 : PN_INFINITY;
+            uint32_t distance = attacking ? UINT32_MAX : 0;
+            size_t best = 0;
+            uint32_t second = PN_INFINITY;
+            bool path = false;
+            for(size_t i = 0; i < children.size(); i++) {
+                const Child& child = children[i];
+                path |= child.path;
+                const uint32_t number = attacking ? child.pn : child.dn;
+                const uint32_t bestNumber = attacking ? children[best].pn : children[best].dn;
+                if(i && number < bestNumber) {
+                    second = bestNumber;
+                    best = i;
+                } else if(i) second = std::min(second, number);
+
+                if(attacking) {
+                    pn = std::min<uint64_t>(pn, child.pn);
+                    dn += child.dn;
+                    if(!child.pn) distance = std::min(distance, child.distance + 1);
+                } else {
+                    pn += child.pn;
+                    dn = std::min<uint64_t>(dn, child.dn);
+                    distance = std::max(distance, child.distance + 1);
+                }
+            }
+            pn = std::min<uint64_t>(pn, PN_INFINITY);
+            dn = std::min<uint64_t>(dn, PN_INFINITY);
+
+            store(key, pn, dn, pn ? 0 : distance, !dn && path);
+            if(pn >= thpn || dn >= thdn || stopped) return;
+
+            // search the most proving child until it stops being the most proving one
+            Child& child = children[best];
+            uint64_t childThpn, childThdn;
+            if(attacking) {
+                childThpn = std::min<uint64_t>(thpn, (uint64_t) second + 1);
+                childThdn = std::min<uint64_t>((uint64_t) thdn - dn + child.dn, PN_INFINITY);
+            } else {
+                childThpn = std::min<uint64_t>((uint64_t) thpn - pn + child.pn, PN_INFINITY);
+                childThdn = std::min<uint64_t>(thdn, (uint64_t) second + 1);
+            }
+
+            board.move(board.toPlay, child.move);
+            search(board, child.key, (remaining == MATE_UNLIMITED) ? MATE_UNLIMITED : remaining - 1, childThpn, childThdn);
+            board.unmove(child.move);
+
+            update(children);
+        }
+    }
+
+public:
+    MateSolver() : table(MATE_TABLE_SIZE) {}
+
+    // search for a mate by the side to play in at most `moves` moves (0: any mate), giving up at `deadline`
+    MateResult solve(Board& board, unsigned int moves = 0, Time deadline = Time::max()) {
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::fill(table.begin(), table.end(), Entry{0, 0, 0, 0, false});
+        attacker = board.toPlay;
+        nodes = 0;
+        stopped = false;
+        this->deadline = deadline;
+
+        MateResult result = {MateStatus::UNKNOWN, 0, {}, 0, 0};
+        if(board.result != GameResult::IN_PROGRESS) return result;
+
+        const int plies = moves ? 2 * moves - 1 : MATE_UNLIMITED;
+        const ZobristHash root = key(board, plies);
+        search(board, root, plies, PN_INFINITY, PN_INFINITY);
+
+        const Entry& entry = table[root % MATE_TABLE_SIZE];
+        if(!stopped && entry.key == root) result.status = entry.pn ? MateStatus::NO_CHECKING_MATE : MateStatus::MATE;
+        if(result.status == MateStatus::MATE) {
+            result.plies = entry.distance;
+            result.line = line(board, plies);
+        }
+
+        result.nodes = nodes;
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return result;
+    }
+
+private:
+    // follow the proof from the current position: the attacker's quickest proven mate against the defender's longest
+    // proven resistance (the line ends early if the hash table lost part of the proof)
+    std::vector<Move> line(Board& board, int remaining) {
+        std::vector<Move> line;
+        while(board.result == GameResult::IN_PROGRESS) {
+            const bool attacking = board.toPlay == attacker;
+            std::vector<Child> children = expand(board, remaining);
+
+            const Child * next = NULL;
+            for(const Child& child : children) {
+                if(child.pn) {
+                    if(attacking) continue;
+                    next = NULL;
+                    break;
+                }
+                if(!next || (attacking ? child.distance < next->distance : child.distance > next->distance)) next = &child;
+            }
+            if(!next) break;
+
+            Move move = next->move;
+            board.toAlgebraic(move, move.algebraic);
+            board.move(board.toPlay, move);
+            line.push_back(move);
+            if(remaining != MATE_UNLIMITED) remaining--;
+        }
+
+        for(std::vector<Move>::reverse_iterator move = line.rbegin(); move != line.rend(); move++) board.unmove(*move);
+        return line;
+    }
+};
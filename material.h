@@ -0,0 +1,115 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "types.h"
+#include "weights.h"
+
+/* Material configurations: what the evaluation derives from the numbers of pieces alone (the material balance, the game
+    phase, which known ending the position is and how drawish it is) is computed once per configuration and kept in a
+    small hash table. Positions are looked up by their material key, which holds each color's count of each piece type
+    (other than kings) in four bits and is updated incrementally by move(). */
+
+// position of the count of `color`'s pieces of type `type` (PAWN - QUEEN) in a material key
+#define MATERIAL_SHIFT(color, type) (4 * (5 * (color) + (type)))
+
+// number of `color`'s pieces of type `type` in the material key `key`
+#define MATERIAL_COUNT(key, color, type) ((int) (((key) >> MATERIAL_SHIFT(color, type)) & 15))
+
+// material key of a single piece of `color` and `type`
+#define MATERIAL_PIECE(color, type) ((MaterialKey) 1 << MATERIAL_SHIFT(color, type))
+
+// number of entries in the material hash table (a power of two)
+#define MATERIAL_TABLE_BITS 13
+#define MATERIAL_TABLE_SIZE (1 << MATERIAL_TABLE_BITS)
+
+// game phase of the starting position (the phase is the sum of PHASE_WEIGHTS over the pieces, capped at MAX_PHASE, so it
+// decreases to 0 as the pieces other than pawns are traded)
+#define MAX_PHASE 24
+const int PHASE_WEIGHTS[6] = {0, 1, 1, 2, 4, 0};
+
+// scale factors applied to evaluations in endgames that are harder to win than the material suggests (SCALE_NORMAL
+// leaves the evaluation unchanged)
+#define SCALE_NORMAL 64
+#define SCALE_DRAWISH 16 // no pawns and at most a minor piece more than the opponent
+#define SCALE_OPPOSITE_BISHOPS 32 // bishops of opposite colors (and pawns) only
+
+// endings with a specialized evaluation
+enum class Ending : uint8_t {
+    NONE,
+    KPK, // king and pawn versus king (evaluated by the KPK bitbase)
+    KXK, // enough material to force mate versus a bare king
+    OPPOSITE_BISHOPS // one bishop each plus pawns (scaled down if the bishops are on squares of different colors)
+};
+
+// what is known about a material configuration
+struct MaterialEntry {
+    MaterialKey key;
+    int32_t imbalance; // material evaluation (piece values and bishop pairs, from white's point of view)
+    uint8_t phase; // game phase (from MAX_PHASE in the opening to 0 with kings and pawns only)
+    uint8_t scale[2]; // scale factor of evaluations in favor of each color
+    Ending ending; // specialized evaluation
+    PieceColor strong; // the side playing for the win in KPK and KXK endings
+};
+
+// analyze the material configuration with key `key`
+inline MaterialEntry analyzeMaterial(MaterialKey key) {
+    MaterialEntry entry = {key, 0, 0, {SCALE_NORMAL, SCALE_NORMAL}, Ending::NONE, WHITE};
+
+    int count[2][5], pieces[2] = {0, 0}, value[2] = {0, 0}; // pieces and value of pieces other than pawns
+    int phase = 0;
+    for(PieceColor color : {WHITE, BLACK}) {
+        for(int type = PAWN; type <= QUEEN; type++) {
+            const int n = count[color][type] = MATERIAL_COUNT(key, color, type);
+            entry.imbalance += (color ? -1 : 1) * n * PIECE_VALUES[type];
+            phase += n * PHASE_WEIGHTS[type];
+            if(type != PAWN) {
+                pieces[color] += n;
+                value[color] += n * PIECE_VALUES[type];
+            }
+        }
+        if(count[color][BISHOP] >= 2) entry.imbalance += (color ? -1 : 1) * BISHOP_PAIR_BONUS;
+    }
+    entry.phase = std::min(phase, MAX_PHASE);
+
+    for(PieceColor color : {WHITE, BLACK}) {
+        const int * own = count[color];
+
+        // known endings against a bare king
+        if(!pieces[!color] && !count[!color][PAWN]) {
+            if(!pieces[color] && own[PAWN] == 1) entry.ending = Ending::KPK;
+            else if(own[QUEEN] || own[ROOK] || own[BISHOP] >= 2 || (own[BISHOP] && own[KNIGHT])) entry.ending = Ending::KXK;
+            if(entry.ending != Ending::NONE) entry.strong = color;
+        }
+
+        // without pawns, a minor piece more (or two knights against a bare king) is rarely enough to win
+        if(!own[PAWN]) {
+            if(value[color] - value[!color] <= PIECE_VALUES[BISHOP]) entry.scale[color] = (value[color] < PIECE_VALUES[ROOK]) ? 0 : SCALE_DRAWISH;
+            else if(own[KNIGHT] == pieces[color] && !pieces[!color] && !count[!color][PAWN]) entry.scale[color] = 0;
+        }
+    }
+
+    if(entry.ending == Ending::NONE && pieces[WHITE] == 1 && pieces[BLACK] == 1 && count[WHITE][BISHOP] == 1 && count[BLACK][BISHOP] == 1)
+        entry.ending = Ending::OPPOSITE_BISHOPS;
+
+    return entry;
+}
+
+// material configurations analyzed so far, indexed by a hash of their key (an entry is replaced by the next configuration
+// that maps to it)
+class MaterialTable {
+private:
+    std::vector<MaterialEntry> entries;
+
+public:
+    // (key 0 - bare kings - maps to the first entry, so filling the table with its entry leaves no entry invalid)
+    MaterialTable() : entries(MATERIAL_TABLE_SIZE, analyzeMaterial(0)) {}
+
+    // the entry of the material configuration with key `key`
+    const MaterialEntry& operator[](MaterialKey key) {
+        MaterialEntry& entry = entries[(key * 0x9e3779b97f4a7c15ULL) >> (64 - MATERIAL_TABLE_BITS)];
+        if(entry.key != key) entry = analyzeMaterial(key);
+        return entry;
+    }
+};
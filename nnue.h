@@ -0,0 +1,281 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+#include "board.h"
+
+/* Efficiently updatable neural network (NNUE) evaluation.
+
+    The network uses HalfKP input features: for each side (perspective), every non-king piece on the board is one of
+    64 x 10 x 64 features given by that side's king square, the piece's type and whether it is the side's own piece, and
+    the piece's square (mirrored vertically for black, so that both perspectives see the board the same way).
+
+        features (2 x 40960, binary) -> feature transformer (int16, 2 x 128) -> clipped ReLU
+        -> hidden layer (int8, 32) -> clipped ReLU -> output (int8, 1)
+
+    The outputs of the feature transformer (the accumulators) are sums of the weight rows of the active features. Each
+    move only changes a few features, so an accumulator is computed from its parent's by adding and subtracting a few rows
+    (a side's accumulator is only recomputed from scratch when its king moves). Board::move() records the pieces that
+    moved in the new ply's GameState and unmove() just returns to the parent's ply, so the accumulators are brought up to
+    date lazily when a position is evaluated.
+
+    The default network is built in: it only counts material (with the standard piece values). Trained networks are
+    loaded from files with the layout of NetworkWeights (little-endian) after an 8 byte NNUE_MAGIC header.
+*/
+
+// number of piece kinds per perspective (own and enemy pawns, knights, bishops, rooks and queens)
+#define NNUE_KINDS 10
+
+// number of input features per perspective
+#define NNUE_FEATURES (64 * NNUE_KINDS * 64)
+
+// layer sizes (a multiple of 32, so that every kernel works on whole vectors)
+#define NNUE_L1 128
+#define NNUE_L2 32
+
+// the hidden layer's outputs are divided by 2^NNUE_SHIFT and the network's output by NNUE_OUTPUT_SCALE (to centipawns)
+#define NNUE_SHIFT 6
+#define NNUE_OUTPUT_SCALE 2
+
+// maximum number of plies an accumulator is updated across before it is recomputed instead
+#define NNUE_UPDATE_PLIES 16
+
+// network file header
+#define NNUE_MAGIC "HALFKP01"
+
+/* kernels (AVX2, SSE4.1 or scalar) */
+
+// row += weights
+inline void nnueAdd(int16_t * row, const int16_t * weights) {
+#if defined(__AVX2__)
+    for(int i = 0; i < NNUE_L1; i += 16) {
+        __m256i * r = (__m256i *) (row + i);
+        _mm256_store_si256(r, _mm256_add_epi16(_mm256_load_si256(r), _mm256_load_si256((const __m256i *) (weights + i))));
+    }
+#elif defined(__SSE4_1__)
+    for(int i = 0; i < NNUE_L1; i += 8) {
+        __m128i * r = (__m128i *) (row + i);
+        _mm_store_si128(r, _mm_add_epi16(_mm_load_si128(r), _mm_load_si128((const __m128i *) (weights + i))));
+    }
+#else
+    for(int i = 0; i < NNUE_L1; i++) row[i] += weights[i];
+#endif
+}
+
+// row -= weights
+inline void nnueSubtract(int16_t * row, const int16_t * weights) {
+#if defined(__AVX2__)
+    for(int i = 0; i < NNUE_L1; i += 16) {
+        __m256i * r = (__m256i *) (row + i);
+        _mm256_store_si256(r, _mm256_sub_epi16(_mm256_load_si256(r), _mm256_load_si256((const __m256i *) (weights + i))));
+    }
+#elif defined(__SSE4_1__)
+    for(int i = 0; i < NNUE_L1; i += 8) {
+        __m128i * r = (__m128i *) (row + i);
+        _mm_store_si128(r, _mm_sub_epi16(_mm_load_si128(r), _mm_load_si128((const __m128i *) (weights + i))));
+    }
+#else
+    for(int i = 0; i < NNUE_L1; i++) row[i] -= weights[i];
+#endif
+}
+
+// output[i] = clamp(input[i], 0, 127) for `n` (a multiple of 32) values
+inline void nnueClippedRelu(const int16_t * input, uint8_t * output, int n) {
+#if defined(__AVX2__)
+    const __m256i zero = _mm256_setzero_si256();
+    for(int i = 0; i < n; i += 32) {
+        // packing saturates to [-128, 127] but interleaves the 128-bit lanes, which the permutation undoes
+        const __m256i packed = _mm256_packs_epi16(_mm256_load_si256((const __m256i *) (input + i)), _mm256_load_si256((const __m256i *) (input + i + 16)));
+        _mm256_store_si256((__m256i *) (output + i), _mm256_permute4x64_epi64(_mm256_max_epi8(packed, zero), 0xd8));
+    }
+#elif defined(__SSE4_1__)
+    const __m128i zero = _mm_setzero_si128();
+    for(int i = 0; i < n; i += 16) {
+        const __m128i packed = _mm_packs_epi16(_mm_load_si128((const __m128i *) (input + i)), _mm_load_si128((const __m128i *) (input + i + 8)));
+        _mm_store_si128((__m128i *) (output + i), _mm_max_epi8(packed, zero));
+    }
+#else
+    for(int i = 0; i < n; i++) output[i] = std::clamp<int16_t>(input[i], 0, 127);
+#endif
+}
+
+// returns the dot product of `n` (a multiple of 32) unsigned 8-bit inputs (at most 127) and signed 8-bit weights
+inline int32_t nnueDot(const uint8_t * input, const int8_t * weights, int n) {
+#if defined(__AVX2__)
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i sum = _mm256_setzero_si256();
+    for(int i = 0; i < n; i += 32) {
+        const __m256i products = _mm256_maddubs_epi16(_mm256_load_si256((const __m256i *) (input + i)), _mm256_load_si256((const __m256i *) (weights + i)));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(products, ones));
+    }
+    __m128i total = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    total = _mm_add_epi32(total, _mm_shuffle_epi32(total, 0x4e));
+    total = _mm_add_epi32(total, _mm_shuffle_epi32(total, 0xb1));
+    return _mm_cvtsi128_si32(total);
+#elif defined(__SSE4_1__)
+    const __m128i ones = _mm_set1_epi16(1);
+    __m128i sum = _mm_setzero_si128();
+    for(int i = 0; i < n; i += 16) {
+        const __m128i products = _mm_maddubs_epi16(_mm_load_si128((const __m128i *) (input + i)), _mm_load_si128((const __m128i *) (weights + i)));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(products, ones));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4e));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xb1));
+    return _mm_cvtsi128_si32(sum);
+#else
+    int32_t sum = 0;
+    for(int i = 0; i < n; i++) sum += input[i] * weights[i];
+    return sum;
+#endif
+}
+
+/* network */
+
+// the outputs of the feature transformer for both perspectives in one position
+struct alignas(64) Accumulator {
+    int16_t values[2][NNUE_L1]; // indexed by perspective
+    ZobristHash key = 0; // key of the position the values were computed for (0 if they are stale)
+};
+
+// network parameters (in file order)
+struct alignas(64) NetworkWeights {
+    int16_t featureBiases[NNUE_L1];
+    int16_t featureWeights[NNUE_FEATURES][NNUE_L1];
+    int32_t hiddenBiases[NNUE_L2];
+    int8_t hiddenWeights[NNUE_L2][2 * NNUE_L1]; // the side to play's accumulator comes first
+    int32_t outputBias;
+    alignas(64) int8_t outputWeights[NNUE_L2];
+};
+
+class Network {
+private:
+    std::unique_ptr<NetworkWeights> weights;
+
+    // index of the square `coord` from the point of view of `perspective`
+    static int square(PieceColor perspective, Coord coord) {
+        const int square = 8 * (coord.rank - 1) + (coord.file - 1);
+        return perspective ? square ^ 56 : square;
+    }
+
+    // weight row of the feature of `piece` on `coord` for `perspective`, whose king is on `king`
+    const int16_t * row(PieceColor perspective, int king, Square piece, Coord coord) const {
+        const int kind = 2 * PIECE_TYPE(piece) + (PIECE_COLOR(piece) != perspective);
+        return weights->featureWeights[(king * NNUE_KINDS + kind) * 64 + square(perspective, coord)];
+    }
+
+    // recompute the accumulator of `perspective` from the pieces on the board
+    void refresh(const Board& board, PieceColor perspective, Accumulator& accumulator) const {
+        int16_t * values = accumulator.values[perspective];
+        const int king = square(perspective, board.remaining[perspective][KING].front());
+        memcpy(values, weights->featureBiases, sizeof(weights->featureBiases));
+        for(PieceColor color : {WHITE, BLACK})
+            for(PieceType type : {PAWN, KNIGHT, BISHOP, ROOK, QUEEN})
+                for(Coord coord : board.remaining[color][type]) nnueAdd(values, row(perspective, king, PIECE_CODE(color, type), coord));
+    }
+
+    // apply the changes made by the move recorded in `state` to the accumulator of `perspective`
+    void update(const GameState& state, PieceColor perspective, int king, int16_t * values) const {
+        auto add = [&](Square piece, Coord coord) { if(PIECE_TYPE(piece) != KING) nnueAdd(values, row(perspective, king, piece, coord)); };
+        auto subtract = [&](Square piece, Coord coord) { if(PIECE_TYPE(piece) != KING) nnueSubtract(values, row(perspective, king, piece, coord)); };
+
+        subtract(state.moved, state.from);
+        add(state.promoted ? state.promoted : state.moved, state.to);
+        if(state.captured) subtract(state.captured, state.enPassant ? Coord{state.to.file, state.from.rank} : state.to);
+
+        // castling also moves the rook
+        if(PIECE_TYPE(state.moved) == KING && abs(state.to.file - state.from.file) == 2) {
+            const Square rook = PIECE_CODE(PIECE_COLOR(state.moved), ROOK);
+            const bool kingside = state.to.file == File::G;
+            subtract(rook, {kingside ? File::H : File::A, state.from.rank});
+            add(rook, {kingside ? File::F : File::D, state.from.rank});
+        }
+    }
+
+public:
+    // build the default network, which evaluates material only: each side's accumulator counts its own (first value) and
+    // the enemy's (second value) material in units of half a pawn, and the hidden layer passes the two on to the output
+    Network() : weights(std::make_unique<NetworkWeights>()) {
+        memset(weights.get(), 0, sizeof(NetworkWeights));
+        const int units[5] = {2, 6, 6, 10, 18}; // pawn, knight, bishop, rook and queen values in half pawns
+        for(int king = 0; king < 64; king++) {
+            for(int kind = 0; kind < NNUE_KINDS; kind++) {
+                for(int square = 0; square < 64; square++)
+                    weights->featureWeights[(king * NNUE_KINDS + kind) * 64 + square][kind % 2] = units[kind / 2];
+            }
+        }
+        weights->hiddenWeights[0][0] = weights->hiddenWeights[1][1] = 1 << NNUE_SHIFT;
+        weights->outputWeights[0] = 50 * NNUE_OUTPUT_SCALE;
+        weights->outputWeights[1] = -50 * NNUE_OUTPUT_SCALE;
+    }
+
+    // load a network from `path` - returns false if the file is missing or malformed (the network is left unchanged)
+    bool load(const char * path) {
+        std::ifstream file(path, std::ios::binary);
+        char magic[8];
+        if(!file.read(magic, sizeof(magic)) || memcmp(magic, NNUE_MAGIC, sizeof(magic))) return false;
+
+        std::unique_ptr<NetworkWeights> loaded = std::make_unique<NetworkWeights>();
+        const bool ok = file.read((char *) loaded->featureBiases, sizeof(loaded->featureBiases))
+                     && file.read((char *) loaded->featureWeights, sizeof(loaded->featureWeights))
+                     && file.read((char *) loaded->hiddenBiases, sizeof(loaded->hiddenBiases))
+                     && file.read((char *) loaded->hiddenWeights, sizeof(loaded->hiddenWeights))
+                     && file.read((char *) &loaded->outputBias, sizeof(loaded->outputBias))
+                     && file.read((char *) loaded->outputWeights, sizeof(loaded->outputWeights))
+                     && file.peek() == EOF;
+        if(ok) weights = std::move(loaded);
+        return ok;
+    }
+
+    // bring the accumulator of the current position (`stack[board.ply]`, where `stack` holds one accumulator per ply) up
+    // to date, starting from the closest ancestor whose accumulator is still current
+    const Accumulator& accumulate(const Board& board, Accumulator * stack) const {
+        Accumulator& accumulator = stack[board.ply];
+        if(accumulator.key == board.hash()) return accumulator;
+
+        int ply = board.ply;
+        while(ply > 0 && board.ply - ply < NNUE_UPDATE_PLIES && stack[ply - 1].key != board.states[ply - 1].key) ply--;
+
+        for(PieceColor perspective : {WHITE, BLACK}) {
+            // a king move changes all of its side's features
+            bool moved = ply == 0 || stack[ply - 1].key != board.states[ply - 1].key;
+            for(int i = ply; i <= board.ply && !moved; i++) moved = board.states[i].moved == PIECE_CODE(perspective, KING);
+            if(moved) {
+                refresh(board, perspective, accumulator);
+                continue;
+            }
+
+            int16_t * values = accumulator.values[perspective];
+            const int king = square(perspective, board.remaining[perspective][KING].front());
+            memcpy(values, stack[ply - 1].values[perspective], sizeof(accumulator.values[perspective]));
+            for(int i = ply; i <= board.ply; i++) update(board.states[i], perspective, king, values);
+        }
+
+        accumulator.key = board.hash();
+        return accumulator;
+    }
+
+    // evaluate the position (in centipawns, from white's point of view) using the accumulator stack `stack`
+    int evaluate(const Board& board, Accumulator * stack) const {
+        const Accumulator& accumulator = accumulate(board, stack);
+
+        alignas(64) uint8_t input[2 * NNUE_L1];
+        nnueClippedRelu(accumulator.values[board.toPlay], input, NNUE_L1);
+        nnueClippedRelu(accumulator.values[!board.toPlay], input + NNUE_L1, NNUE_L1);
+
+        alignas(64) int16_t sums[NNUE_L2];
+        for(int i = 0; i < NNUE_L2; i++) sums[i] = std::clamp((weights->hiddenBiases[i] + nnueDot(input, weights->hiddenWeights[i], 2 * NNUE_L1)) >> NNUE_SHIFT, -128, 127);
+        alignas(64) uint8_t hidden[NNUE_L2];
+        nnueClippedRelu(sums, hidden, NNUE_L2);
+
+        const int evaluation = (weights->outputBias + nnueDot(hidden, weights->outputWeights, NNUE_L2)) / NNUE_OUTPUT_SCALE;
+        return board.toPlay ? -evaluation : evaluation;
+    }
+};
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+
+#include "board.h"
+
+/* Packed positions: training positions (e.g. from datagen) labelled with a search score and the game's result, stored in
+    32 bytes each so that billions of them fit on disk and load without parsing any text.
+
+    A position file begins with a 32 byte header (PACKED_MAGIC, PACKED_VERSION and the size of a position) followed by the
+    positions, which are stored as they are laid out in memory. Squares are numbered a1 = 0 ... h8 = 63. */
+
+#define PACKED_MAGIC 0x44504843u // "CHPD"
+#define PACKED_VERSION 1
+#define PACKED_HEADER_SIZE 32
+
+// game results as stored in packed positions (from white's side)
+#define PACKED_LOSS 0
+#define PACKED_DRAW 1
+#define PACKED_WIN 2
+
+// a position in 32 bytes
+struct PackedPosition {
+    uint64_t occupied; // squares holding a piece
+    uint8_t pieces[16]; // piece codes (1 - 12) of the occupied squares in ascending order, two per byte (low nibble first)
+    uint8_t flags; // side to play (bit 0) and castling rights (bits 1 - 4: white queen, white king, black queen, black king)
+    uint8_t passant; // file of the pawn that can be captured en passant (NONE if there isn't one)
+    uint8_t halfmoves; // plies since the last capture or pawn move
+    uint8_t result; // result of the game (PACKED_LOSS, PACKED_DRAW or PACKED_WIN for white)
+    int16_t score; // search score in centipawns (from white's side)
+    uint16_t fullmoves; // full move number
+
+    // pack the position on `board` (which has at most 32 pieces)
+    void pack(const Board& board, int score, uint8_t result) {
+        const GameState& state = board.state();
+        occupied = 0;
+        memset(pieces, 0, sizeof(pieces));
+        int n = 0;
+        for(int square = 0; square < 64; square++) {
+            const Square piece = board.board[square / 8 + 1][square % 8 + 1];
+            if(!piece) continue;
+            occupied |= 1ULL << square;
+            pieces[n / 2] |= piece << (4 * (n % 2));
+            n++;
+        }
+
+        flags = board.toPlay;
+        for(int i = 0; i < 4; i++) flags |= state.canCastle[i / 2][i % 2] << (i + 1);
+        passant = state.passant;
+        halfmoves = state.plies;
+        this->result = result;
+        this->score = (int16_t) std::clamp(score, INT16_MIN, INT16_MAX);
+        fullmoves = (uint16_t) std::min(board.fullmoves, (unsigned int) UINT16_MAX);
+    }
+
+    // set up the position on `board` - returns false if it isn't a valid position
+    bool unpack(Board& board) const {
+        board.clear();
+        uint64_t squares = occupied;
+        for(int n = 0; squares; n++, squares &= squares - 1) {
+            if(n == 32) return false;
+            const int square = __builtin_ctzll(squares);
+            const Square piece = (pieces[n / 2] >> (4 * (n % 2))) & 15;
+            if(piece == EMPTY || piece > PIECE_CODE(BLACK, KING)) return false;
+            if(!board.place(PIECE_COLOR(piece), PIECE_TYPE(piece), {(File) (square % 8 + 1), (Rank) (square / 8 + 1)})) return false;
+        }
+        if(board.remaining[WHITE][KING].size() != 1 || board.remaining[BLACK][KING].size() != 1) return false;
+
+        // castling rights and the passant candidate are only kept if the pieces involved are where they have to be
+        board.toPlay = (PieceColor) (flags & 1);
+        GameState& state = board.states[0];
+        state = {0, 0, {{false, false}, {false, false}}, File::NONE, 0, EMPTY, EMPTY, EMPTY, false, {File::NONE, 0}, {File::NONE, 0}};
+        for(int i = 0; i < 4; i++) {
+            const PieceColor color = (PieceColor) (i / 2);
+            state.canCastle[color][i % 2] = (flags >> (i + 1)) & 1 && board.board[RANK(color, 1)][File::E] == PIECE_CODE(color, KING)
+                                         && board.board[RANK(color, 1)][(i % 2) ? File::H : File::A] == PIECE_CODE(color, ROOK);
+        }
+        if(passant >= File::A && passant <= File::H && board.board[RANK(!board.toPlay, 4)][passant] == PIECE_CODE(!board.toPlay, PAWN))
+            state.passant = (File) passant;
+        state.plies = std::min<uint8_t>(halfmoves, 100);
+        board.fullmoves = std::max<unsigned int>(fullmoves, 1);
+        board.finishSetup();
+        return true;
+    }
+};
+static_assert(sizeof(PackedPosition) == 32);
+
+// appends positions to a position file
+class PackedPositionWriter {
+private:
+    std::ofstream file;
+
+public:
+    // open the position file at `path`, creating it if it doesn't exist - returns false if it can't be written to
+    bool open(const char * path) {
+        file.open(path, std::ios::binary | std::ios::app);
+        if(!file) return false;
+        if(file.tellp() == 0) {
+            const uint32_t header[PACKED_HEADER_SIZE / 4] = {PACKED_MAGIC, PACKED_VERSION, sizeof(PackedPosition)};
+            file.write((const char *) header, sizeof(header));
+        }
+        return (bool) file;
+    }
+
+    // append `count` positions - returns true upon success
+    bool write(const PackedPosition * positions, size_t count) {
+        return (bool) file.write((const char *) positions, count * sizeof(PackedPosition)).flush();
+    }
+};
+
+// a read-only, memory-mapped position file
+class PackedPositionFile {
+private:
+    void * mapping = NULL;
+    size_t length = 0;
+    const PackedPosition * positions = NULL;
+    size_t count = 0;
+
+public:
+    PackedPositionFile(const char * path) {
+        int fd = open(path, O_RDONLY);
+        if(fd < 0) return;
+
+        struct stat st;
+        uint32_t header[PACKED_HEADER_SIZE / 4];
+        if(!fstat(fd, &st) && (size_t) st.st_size >= PACKED_HEADER_SIZE && pread(fd, header, sizeof(header), 0) == sizeof(header)
+            && header[0] == PACKED_MAGIC && header[1] == PACKED_VERSION && header[2] == sizeof(PackedPosition)) {
+            void * file = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(file != MAP_FAILED) {
+                madvise(file, st.st_size, MADV_SEQUENTIAL);
+                mapping = file;
+                length = st.st_size;
+                positions = (const PackedPosition *) ((const uint8_t *) file + PACKED_HEADER_SIZE);
+                count = (length - PACKED_HEADER_SIZE) / sizeof(PackedPosition);
+            }
+        }
+        close(fd);
+    }
+
+    PackedPositionFile(const PackedPositionFile&) = delete;
+    PackedPositionFile& operator=(const PackedPositionFile&) = delete;
+
+    ~PackedPositionFile() {
+        if(mapping) munmap(mapping, length);
+    }
+
+    bool isOpen() const { return mapping; }
+
+    // whether the file starts like a position file (rather than e.g. EPD)
+    static bool identify(const char * path) {
+        std::ifstream file(path, std::ios::binary);
+        uint32_t magic;
+        return file.read((char *) &magic, sizeof(magic)) && magic == PACKED_MAGIC;
+    }
+
+    // number of positions
+    size_t size() const { return count; }
+
+    const PackedPosition& operator[](size_t i) const { return positions[i]; }
+    const PackedPosition * begin() const { return positions; }
+    const PackedPosition * end() const { return positions + count; }
+};
@@ -0,0 +1,268 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <ostream>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "board.h"
+
+// a single game within a PGN file (all views point into the mapped file)
+struct PgnGame {
+    std::string_view tags; // tag pair section
+    std::string_view movetext; // movetext section
+
+    // value of the tag `name` (empty if the tag is not present)
+    std::string_view tag(std::string_view name) const {
+        size_t i = 0;
+        while((i = tags.find('[', i)) != std::string_view::npos) {
+            i++;
+            if(i + name.size() >= tags.size() || tags.substr(i, name.size()) != name || tags[i + name.size()] != ' ') continue;
+            size_t begin = tags.find('"', i);
+            size_t end = tags.find('"', begin + 1);
+            if(begin == std::string_view::npos || end == std::string_view::npos) break;
+            return tags.substr(begin + 1, end - begin - 1);
+        }
+        return {};
+    }
+
+    // game result recorded in the Result tag
+    GameResult result() const {
+        std::string_view result = tag("Result");
+        if(result == "1-0") return GameResult::WHITE_WINS;
+        if(result == "0-1") return GameResult::BLACK_WINS;
+        if(result == "1/2-1/2") return GameResult::DRAW_BY_REPETITION;
+        return GameResult::IN_PROGRESS;
+    }
+};
+
+// a read-only, memory-mapped PGN file
+class PgnFile {
+private:
+    const char * data = NULL;
+    size_t length = 0;
+
+public:
+    PgnFile(const char * path) {
+        int fd = open(path, O_RDONLY);
+        if(fd < 0) return;
+
+        struct stat st;
+        if(!fstat(fd, &st) && st.st_size > 0) {
+            void * mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(mapping != MAP_FAILED) {
+                madvise(mapping, st.st_size, MADV_SEQUENTIAL);
+                data = (const char *) mapping;
+                length = st.st_size;
+            }
+        }
+        close(fd);
+    }
+
+    PgnFile(const PgnFile&) = delete;
+    PgnFile& operator=(const PgnFile&) = delete;
+
+    ~PgnFile() {
+        if(data) munmap((void *) data, length);
+    }
+
+    bool isOpen() const { return data; }
+
+    std::string_view text() const { return std::string_view(data, length); }
+
+    // split `text` into (at most) `parts` pieces that each begin at the start of a game
+    static std::vector<std::string_view> split(std::string_view text, unsigned int parts) {
+        std::vector<std::string_view> pieces;
+        size_t begin = 0;
+        for(unsigned int part = 1; part <= parts && begin < text.size(); part++) {
+            size_t end = text.size();
+            if(part < parts) {
+                // advance to the next tag section that follows movetext
+                end = std::max(begin, text.size() * part / parts);
+                while((end = text.find("\n[", end)) != std::string_view::npos) {
+                    size_t previous = text.find_last_not_of(" \t\r\n", end);
+                    if(previous == std::string_view::npos || text[previous] != ']') break;
+                    end++;
+                }
+                end = (end == std::string_view::npos) ? text.size() : end + 1;
+            }
+            pieces.push_back(text.substr(begin, end - begin));
+            begin = end;
+        }
+        return pieces;
+    }
+
+    // read the next game from `text` (advancing past it) - returns false once there are no games left
+    static bool next(std::string_view& text, PgnGame& game) {
+        size_t i = text.find_first_not_of(" \t\r\n");
+        if(i == std::string_view::npos) return false;
+
+        // tag pairs are lines that begin with '['
+        size_t tagsBegin = i;
+        while(i < text.size() && text[i] == '[') {
+            i = text.find('\n', i);
+            if(i == std::string_view::npos) i = text.size();
+            i = text.find_first_not_of(" \t\r\n", i);
+            if(i == std::string_view::npos) i = text.size();
+        }
+        game.tags = text.substr(tagsBegin, i - tagsBegin);
+
+        // movetext continues until the next line that begins with '['
+        size_t end = i;
+        while((end = text.find("\n[", end)) != std::string_view::npos) {
+            // ignore '[' within comments by requiring the line to look like a tag pair
+            size_t close = text.find(']', end);
+            size_t newline = text.find('\n', end + 1);
+            if(close != std::string_view::npos && (newline == std::string_view::npos || close < newline)) break;
+            end++;
+        }
+        if(end == std::string_view::npos) end = text.size();
+
+        game.movetext = text.substr(i, end - i);
+        text.remove_prefix(end);
+        return true;
+    }
+};
+
+// iterates over the move tokens of a movetext section (skipping comments, variations, NAGs, move numbers and results)
+class PgnTokenizer {
+private:
+    std::string_view text;
+    size_t i = 0;
+
+public:
+    PgnTokenizer(std::string_view text) : text(text) {}
+
+    // returns false once the movetext is exhausted
+    bool next(std::string_view& token) {
+        int depth = 0; // variation nesting depth
+
+        while(i < text.size()) {
+            const char c = text[i];
+
+            if(c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '.') i++;
+            else if(c == '{') { // comment
+                i = text.find('}', i);
+                i = (i == std::string_view::npos) ? text.size() : i + 1;
+            } else if(c == ';' || (c == '%' && (i == 0 || text[i - 1] == '\n'))) { // rest-of-line comment or escape
+                i = text.find('\n', i);
+                if(i == std::string_view::npos) i = text.size();
+            } else if(c == '(') {
+                depth++;
+                i++;
+            } else if(c == ')') {
+                if(depth) depth--;
+                i++;
+            } else {
+                size_t end = text.find_first_of(" \t\r\n(){};", i);
+                if(end == std::string_view::npos) end = text.size();
+                std::string_view word = text.substr(i, end - i);
+                i = end;
+
+                // skip moves in variations, NAGs, move numbers (e.g. "12." or "12...") and game termination markers
+                if(depth || c == '$' || (c >= '0' && c <= '9' && word.find_first_not_of("0123456789.") == std::string_view::npos)) continue;
+                if(word == "1-0" || word == "0-1" || word == "1/2-1/2" || word == "*") continue;
+
+                // a move number directly attached to the move (e.g. "12.e4")
+                size_t dot = word.find_last_of('.');
+                if(dot != std::string_view::npos) word.remove_prefix(dot + 1);
+                if(word.empty()) continue;
+
+                token = word;
+                return true;
+            }
+        }
+
+        return false;
+    }
+};
+
+// replay the moves of `game` on `board`, calling `visit(move, san)` after each move - returns the number of plies
+// played, or -1 if a move could not be resolved (in which case `error` holds the offending token)
+template <typename Visitor>
+int replay(Board& board, const PgnGame& game, Visitor visit, std::string_view& error) {
+    PgnTokenizer tokenizer(game.movetext);
+    std::string_view san;
+    int plies = 0;
+
+    while(tokenizer.next(san)) {
+        Move move;
+        if(!board.parseAlgebraic(board.toPlay, move, san)) {
+            error = san;
+            return -1;
+        }
+
+        // trust the mate marker rather than searching for replies to every move
+        move.mate = san.find('#') != std::string_view::npos;
+        board.move(board.toPlay, move);
+        visit(move, san);
+        plies++;
+    }
+
+    return plies;
+}
+
+int replay(Board& board, const PgnGame& game) {
+    std::string_view error;
+    return replay(board, game, [](Move&, std::string_view) {}, error);
+}
+
+// PGN result string for `result`
+const char * pgnResult(GameResult result) {
+    switch(result) {
+        case GameResult::IN_PROGRESS: return "*";
+        case GameResult::WHITE_WINS: return "1-0";
+        case GameResult::BLACK_WINS: return "0-1";
+        default: return "1/2-1/2";
+    }
+}
+
+// write a game played from `fen` (empty for the standard starting position) as PGN - the moves must have their
+// algebraic descriptions, and the movetext is wrapped at 80 columns
+void writePgn(std::ostream& stream, std::string_view fen, const std::vector<Move>& moves, GameResult result) {
+    stream << "[Event \"?\"]\n[Site \"?\"]\n[Date \"????.??.??\"]\n[Round \"?\"]\n[White \"?\"]\n[Black \"?\"]\n";
+    stream << "[Result \"" << pgnResult(result) << "\"]\n";
+    if(!fen.empty() && fen != STARTING_FEN) stream << "[SetUp \"1\"]\n[FEN \"" << fen << "\"]\n";
+    stream << "\n";
+
+    size_t column = 0;
+    auto word = [&](const std::string& text) {
+        if(column && column + 1 + text.size() > 80) {
+            stream << "\n";
+            column = 0;
+        }
+        if(column) stream << " ";
+        stream << text;
+        column += (column ? 1 : 0) + text.size();
+    };
+
+    for(size_t i = 0; i < moves.size(); i++) {
+        const Move& move = moves[i];
+        const size_t number = (i + (moves.front().piece.color == BLACK)) / 2 + 1;
+        if(move.piece.color == WHITE) word(std::to_string(number) + ". " + move.algebraic);
+        else if(!i) word(std::to_string(number) + "... " + move.algebraic);
+        else word(move.algebraic);
+    }
+    word(pgnResult(result));
+    stream << "\n\n";
+}
+
+// process every game of `text` on `threads` worker threads, calling `work(thread, game)` for each game
+template <typename Work>
+void forEachGame(std::string_view text, unsigned int threads, Work work) {
+    std::vector<std::thread> pool;
+    unsigned int thread = 0;
+    for(std::string_view part : PgnFile::split(text, threads)) {
+        pool.emplace_back([part, thread, &work]() mutable {
+            PgnGame game;
+            while(PgnFile::next(part, game)) work(thread, game);
+        });
+        thread++;
+    }
+    for(std::thread& worker : pool) worker.join();
+}
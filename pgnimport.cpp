@@ -0,0 +1,99 @@
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <getopt.h>
+
+#include "pgn.h"
+
+/* PGN import tool: replays every game of a (possibly very large) PGN file and reports what was read.
+
+    The file is memory-mapped and split at game boundaries into one part per worker thread. Each worker tokenizes the
+    games of its part in place (no text is copied) and resolves the SAN moves on a board of its own, which is reset in
+    place for every game rather than reconstructed.
+*/
+
+// per-thread counters (kept on separate cache lines)
+struct alignas(64) ImportCounts {
+    uint64_t games = 0;
+    uint64_t plies = 0;
+    uint64_t errors = 0;
+    uint64_t results[3] = {0}; // white wins, black wins, draws
+};
+
+int main(int argc, char * argv[]) {
+    unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+    bool verbose = false;
+
+    int opt;
+    while((opt = getopt(argc, argv, "j:v")) != -1) {
+        switch(opt) {
+            case 'j':
+                threads = std::max(1, std::stoi(optarg));
+                break;
+            case 'v':
+                verbose = true;
+                break;
+            default:
+                optind = argc;
+        }
+    }
+    if(optind != argc - 1) {
+        std::cerr << "Usage: pgnimport [options] file.pgn\n";
+        std::cerr << "-j threads : number of worker threads (default: all cores)\n";
+        std::cerr << "-v         : report every game that could not be replayed" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    PgnFile file(argv[optind]);
+    if(!file.isOpen()) {
+        std::cerr << "Could not open PGN file '" << argv[optind] << "'\n";
+        return EXIT_FAILURE;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<ImportCounts> counts(threads);
+    std::vector<Board> boards(threads);
+    std::mutex output;
+
+    forEachGame(file.text(), threads, [&](unsigned int thread, const PgnGame& game) {
+        ImportCounts& count = counts[thread];
+        count.games++;
+
+        Board& board = boards[thread];
+
+        std::string_view fen = game.tag("FEN"), error = fen;
+        int plies = board.setPosition(fen.empty() ? STARTING_FEN : fen) ? replay(board, game, [](Move&, std::string_view) {}, error) : -1;
+        if(plies < 0) {
+            count.errors++;
+            if(verbose) {
+                std::lock_guard<std::mutex> lock(output);
+                std::cerr << "Illegal move or position '" << error << "' in " << game.tag("White") << " - " << game.tag("Black")
+                          << " (" << game.tag("Event") << ", " << game.tag("Date") << ")\n";
+            }
+        } else {
+            count.plies += plies;
+            switch(game.result()) {
+                case GameResult::WHITE_WINS: count.results[0]++; break;
+                case GameResult::BLACK_WINS: count.results[1]++; break;
+                case GameResult::IN_PROGRESS: break;
+                default: count.results[2]++;
+            }
+        }
+    });
+
+    ImportCounts total;
+    for(const ImportCounts& count : counts) {
+        total.games += count.games;
+        total.plies += count.plies;
+        total.errors += count.errors;
+        for(int i = 0; i < 3; i++) total.results[i] += count.results[i];
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("games:   %lu (%lu could not be replayed)\n", total.games, total.errors);
+    printf("plies:   %lu\n", total.plies);
+    printf("results: +%lu -%lu =%lu\n", total.results[0], total.results[1], total.results[2]);
+    printf("time:    %.2fs (%.1f MB/s, %.0f games/s) on %u threads\n", seconds, file.text().size() / seconds / 1e6, total.games / seconds, threads);
+
+    return 0;
+}
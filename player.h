@@ -5,27 +5,51 @@
 #include <sstream>
 
 #include "board.h"
+#include "book.h"
+#include "search.h"
 
 #define DEFAULT_DEPTH 2 // default engine recursion depth
+#define DEFAULT_LINES 3 // default number of lines shown by the `moves` command in debug mode
 
 class Player {
 public:
     PieceColor color;
     unsigned int depth;
+    const Clock * clock = NULL; // game clock (the engine searches to a fixed depth if there isn't one)
 
     Player(PieceColor color = PieceColor::WHITE, unsigned int depth = DEFAULT_DEPTH) : color(color), depth(depth) {}
-    virtual void move(Board& board, bool debug = false) = 0;
+    // make a move on `board` and store it in `move` - returns false if the player resigned instead
+    virtual bool move(Board& board, SearchContext& search, Move& move, bool debug = false) = 0;
 };
 
 class CPUPlayer : public Player {
 public:
+    std::shared_ptr<Book> book; // opening book (optional)
+
     CPUPlayer(PieceColor color) : Player(color) {}
     CPUPlayer(PieceColor color, unsigned int depth) : Player(color, depth) {}
 
-    void move(Board& board, bool debug = false) {
-        Move move = board.bestMove(color, depth);
+    bool move(Board& board, SearchContext& search, Move& move, bool debug = false) {
+        // play a book move without searching if the position is in the opening book
+        if(book && book->probe(board, search.random, move)) {
+            board.toAlgebraic(move, move.algebraic);
+            return board.tryMove(color, move);
+        }
+
+        Line line;
+        if(clock) {
+            TimeManager time(color, clock->left(color), clock->bonus());
+            line = search.bestLine(board, color, MAX_DEPTH, time);
+        } else line = search.bestLine(board, color, depth, search.randomMargin);
+
+        // no legal moves: the game was set up in a finished position (a FEN position isn't checked for mate)
+        if(line.moves.empty()) {
+            board.result = board.inCheck(color) ? (color ? GameResult::WHITE_WINS : GameResult::BLACK_WINS) : GameResult::DRAW_BY_STALEMATE;
+            return false;
+        }
 
-        board.tryMove(color, move);
+        move = line.moves.front();
+        return board.tryMove(color, move);
     }
 };
 
@@ -41,46 +65,69 @@ private:
     }
 
 public:
+    unsigned int lines = DEFAULT_LINES; // number of best lines shown by the `moves` command in debug mode
+
     HumanPlayer(PieceColor color) : Player(color) {}
     HumanPlayer(PieceColor color, unsigned int depth) : Player(color, depth) {}
 
-    void move(Board& board, bool debug = false) {
+    bool move(Board& board, SearchContext& search, Move& played, bool debug = false) {
         std::string move;
 
-        bool valid = false;
-
         // poll user
-        while (!valid) {
+        while (true) {
             std::cout << "Move (" << (color ? "Black" : "White") << "): ";
             std::cin >> move;
 
-            if(debug && move == "evaluate")
-                std::cout << "Evaluation: " << evaluationString(board.evaluatePosition(board.toPlay, INT_MIN, INT_MAX, depth)) << std::endl;
+            if(debug && move == "evaluate") {
+                search.stats.reset();
+                int evaluation = search.evaluatePosition(board, board.toPlay, INT_MIN, INT_MAX, depth);
+                search.stats.iteration(depth);
+                std::cout << "Evaluation: " << evaluationString(evaluation) << std::endl;
+                std::cout << search.stats.text() << std::endl;
+            }
+            if(debug && move == "stats") std::cout << search.stats.json() << std::endl;
+            if(debug && move == "check") {
+                // the best lines' evaluations have to match searches of their first moves on their own, from scratch (with
+                // an empty transposition table, so that no bound found while searching the other lines can leak in)
+                bool matched = true;
+                for(const Line& line : search.bestLines(board, color, depth, lines)) {
+                    std::unique_ptr<SearchContext> fresh = std::make_unique<SearchContext>();
+                    fresh->tablebases = search.tablebases;
+                    fresh->setNetwork(search.network);
+                    Move first = line.moves.front();
+                    const int evaluation = fresh->evaluateMove(board, first, INT_MIN, INT_MAX, depth - 1);
+                    std::cout << first.algebraic << ": " << evaluationString(line.evaluation) << " (alone: " << evaluationString(evaluation) << ")";
+                    std::cout << (evaluation == line.evaluation ? "\n" : " mismatch\n");
+                    matched = matched && evaluation == line.evaluation;
+                }
+                std::cout << (matched ? "The best lines match" : "The best lines don't match") << std::endl;
+            }
+            if(move == "fen") std::cout << board.toFen() << std::endl;
             if (move == "moves") {
                 // list all legal moves in the current position
-                // if debug mode is enabled, evaluations will also be displayed
+                // if debug mode is enabled, the best lines (with their evaluations) will also be displayed
                 std::list<Move> moves = board.getAlgebraicMoves(color);
-                
-                std::cout << "Legal moves:\n";
 
-                // in debug mode, add move evaluations and sort moves by numerical evaluation
                 if(debug) {
-                    PieceColor sideToPlay = board.toPlay;
-                    for (Move& move : moves) board.evaluateMove(move, INT_MIN, INT_MAX, depth);
-                    moves.sort([sideToPlay](const Move& a, const Move& b) {
-                        return BETTER(sideToPlay, a.evaluation, b.evaluation);
-                    });
+                    std::cout << "Best lines:\n";
+                    for(const Line& line : search.bestLines(board, color, depth, lines)) {
+                        std::cout << evaluationString(line.evaluation) << ":";
+                        for(const Move& move : line.moves) std::cout << " " << move.algebraic;
+                        std::cout << "\n";
+                    }
+                    std::cout << "\n";
+                }
 
-                    for(Move& move : moves) std::cout << move.algebraic << " (" << evaluationString(move.evaluation) << ")\n";
-                } else for(Move& move : moves) std::cout << move.algebraic << "\n";
+                std::cout << "Legal moves:\n";
+                for(Move& move : moves) std::cout << move.algebraic << "\n";
 
                 std::cout << std::endl;
             } else if (move == "resign") {
                 board.result = board.toPlay ? GameResult::WHITE_WINS : GameResult::BLACK_WINS;
-                break;
+                return false;
             } else if(move == "exit" || move == "quit") exit(EXIT_SUCCESS);
 
-            if (valid = board.parseMove(color, move, debug)) board.display(debug);
+            if (board.parseMove(color, move, played)) return true;
         }
     }
 };
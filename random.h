@@ -1,33 +1,28 @@
 #pragma once
 
 #include <cstdint>
-#include <cstdio>
-#include <cstdlib>
-#include <iostream>
 
+// default seed of the random move selection and of datagen (fixed so that results are reproducible - the Zobrist keys
+// have a seed of their own, see zobrist.h)
+#define DEFAULT_SEED 0x9e3779b97f4a7c15ULL
+
+// deterministic 64-bit pseudorandom number generator (SplitMix64) that can also be evaluated at compile time
 class Random {
 private:
-    FILE * fp;
+    uint64_t state;
 
 public:
-    Random() {
-        fp = fopen("/dev/urandom", "rb");
-        if (!fp) {
-            std::cerr << "Failed to open /dev/urandom" << std::endl;
-            exit(EXIT_FAILURE);
-        }
-    }
+    constexpr Random(uint64_t seed = DEFAULT_SEED) : state(seed) {}
 
-    ~Random() {
-        fclose(fp);
+    constexpr uint64_t rand64() {
+        uint64_t value = (state += 0x9e3779b97f4a7c15ULL);
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+        return value ^ (value >> 31);
     }
 
-    uint64_t rand64() {
-        uint64_t value;
-        if(fread(&value, sizeof(uint64_t), 1, fp) != 1) {
-            std::cerr << "Failed to read data from /dev/urandom" << std::endl;
-            exit(EXIT_FAILURE);
-        }
-        return value;
+    // returns a pseudorandom integer in the range [0, n)
+    constexpr uint64_t below(uint64_t n) {
+        return rand64() % n;
     }
 };
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <string_view>
+#include <vector>
+
+#include "board.h"
+
+/* Binary game records: a compact alternative to PGN for large numbers of games (e.g. from self-play).
+
+    A record file begins with an 8 byte header (RECORD_MAGIC and RECORD_VERSION) followed by the games, each consisting of
+
+        uint16_t plies           number of moves
+        uint8_t  result          GameResult (IN_PROGRESS for unfinished games)
+        uint8_t  length          length of the FEN of the starting position (0 for the standard starting position)
+        char     fen[length]
+        uint16_t moves[plies]    to | from << 6 | promotion << 12, with squares numbered a1 = 0 ... h8 = 63
+
+    All values are little-endian. As every move names its squares, games are replayed without generating or searching the
+    legal moves of each position.
+*/
+
+#define RECORD_MAGIC 0x52474843u // "CHGR"
+#define RECORD_VERSION 1
+#define RECORD_HEADER_SIZE 8
+
+// size of a game's fixed header (before the FEN)
+#define RECORD_GAME_HEADER_SIZE 4
+
+// a game within a record file (views point into the mapped file)
+struct GameRecord {
+    std::string_view fen; // starting position (empty for the standard starting position)
+    GameResult result;
+    uint16_t plies;
+    const uint8_t * moves; // encoded moves
+
+    // the `i`th encoded move
+    uint16_t move(size_t i) const { return moves[2 * i] | (moves[2 * i + 1] << 8); }
+};
+
+// encode a move in 16 bits
+inline uint16_t encodeMove(const Move& move) {
+    const int from = 8 * (move.from.rank - 1) + (move.from.file - 1);
+    const int to = 8 * (move.to.rank - 1) + (move.to.file - 1);
+    return to | (from << 6) | ((move.moveType == MoveType::PROMOTION ? move.promoteTo : 0) << 12);
+}
+
+// decode a move for the side to play on `board` - returns false if it isn't a pseudolegal move (the other fields of
+// `move` are filled in from the position)
+inline bool decodeMove(Board& board, uint16_t encoded, Move& move) {
+    move.to = {(File) ((encoded & 7) + 1), (Rank) (((encoded >> 3) & 7) + 1)};
+    move.from = {(File) (((encoded >> 6) & 7) + 1), (Rank) (((encoded >> 9) & 7) + 1)};
+    move.promoteTo = (PieceType) ((encoded >> 12) & 7);
+    return board.pseudoLegal(board.toPlay, move);
+}
+
+// appends games to a record file
+class GameRecordWriter {
+private:
+    std::ofstream file;
+
+    void put(uint32_t value, int bytes) {
+        for(int i = 0; i < bytes; i++) file.put((char) (value >> (8 * i)));
+    }
+
+public:
+    // open the record file at `path`, creating it if it doesn't exist - returns false if it can't be written to
+    bool open(const char * path) {
+        file.open(path, std::ios::binary | std::ios::app);
+        if(!file) return false;
+        if(file.tellp() == 0) {
+            put(RECORD_MAGIC, 4);
+            put(RECORD_VERSION, 4);
+        }
+        return (bool) file;
+    }
+
+    bool isOpen() const { return file.is_open(); }
+
+    // append a game played from `fen` (empty for the standard starting position) - returns true upon success
+    bool write(std::string_view fen, const std::vector<Move>& moves, GameResult result) {
+        if(fen == STARTING_FEN) fen = {};
+        if(moves.size() > UINT16_MAX || fen.size() > UINT8_MAX) return false;
+
+        put(moves.size(), 2);
+        put(result, 1);
+        put(fen.size(), 1);
+        file.write(fen.data(), fen.size());
+        for(const Move& move : moves) put(encodeMove(move), 2);
+        return (bool) file.flush();
+    }
+};
+
+// a read-only, memory-mapped record file
+class GameRecordFile {
+private:
+    const uint8_t * data = NULL;
+    size_t length = 0;
+    size_t offset = RECORD_HEADER_SIZE; // position of the next game
+
+    static uint32_t read(const uint8_t * bytes, int n) {
+        uint32_t value = 0;
+        for(int i = 0; i < n; i++) value |= bytes[i] << (8 * i);
+        return value;
+    }
+
+public:
+    GameRecordFile(const char * path) {
+        int fd = open(path, O_RDONLY);
+        if(fd < 0) return;
+
+        struct stat st;
+        if(!fstat(fd, &st) && st.st_size >= RECORD_HEADER_SIZE) {
+            void * mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(mapping != MAP_FAILED) {
+                madvise(mapping, st.st_size, MADV_SEQUENTIAL);
+                data = (const uint8_t *) mapping;
+                length = st.st_size;
+
+                // reject files with an unknown layout
+                if(read(data, 4) != RECORD_MAGIC || read(data + 4, 4) != RECORD_VERSION) {
+                    munmap(mapping, length);
+                    data = NULL;
+                }
+            }
+        }
+        close(fd);
+    }
+
+    GameRecordFile(const GameRecordFile&) = delete;
+    GameRecordFile& operator=(const GameRecordFile&) = delete;
+
+    ~GameRecordFile() {
+        if(data) munmap((void *) data, length);
+    }
+
+    bool isOpen() const { return data; }
+
+    // whether the file starts like a record file (rather than e.g. PGN)
+    static bool identify(const char * path) {
+        std::ifstream file(path, std::ios::binary);
+        uint8_t header[4];
+        return file.read((char *) header, sizeof(header)) && read(header, 4) == RECORD_MAGIC;
+    }
+
+    // read the next game - returns false once there are no complete games left
+    bool next(GameRecord& game) {
+        if(!data || length - offset < RECORD_GAME_HEADER_SIZE) return false;
+
+        const uint8_t * bytes = data + offset;
+        game.plies = read(bytes, 2);
+        game.result = (GameResult) bytes[2];
+        const size_t fenLength = bytes[3];
+        const size_t size = RECORD_GAME_HEADER_SIZE + fenLength + 2 * (size_t) game.plies;
+        if(length - offset < size) return false;
+
+        game.fen = std::string_view((const char *) bytes + RECORD_GAME_HEADER_SIZE, fenLength);
+        game.moves = bytes + RECORD_GAME_HEADER_SIZE + fenLength;
+        offset += size;
+        return true;
+    }
+};
+
+// set up the starting position of `game` on `board` and replay its moves, calling `visit(move)` after each move. Moves
+// are only checked to be pseudolegal unless `verify` is set, in which case they are fully validated and given their
+// algebraic descriptions - returns the number of plies played, or -1 if the position or a move is invalid
+template <typename Visitor>
+int replay(Board& board, const GameRecord& game, Visitor visit, bool verify = false) {
+    if(!board.setPosition(game.fen.empty() ? STARTING_FEN : game.fen)) return -1;
+
+    for(uint16_t i = 0; i < game.plies; i++) {
+        Move move;
+        if(board.ply + 2 >= MAX_PLIES || !decodeMove(board, game.move(i), move)) return -1;
+        if(verify) {
+            if(!board.validate(board.toPlay, move)) return -1;
+            board.toAlgebraic(move, move.algebraic);
+        }
+
+        board.move(board.toPlay, move);
+        visit(move);
+    }
+
+    return game.plies;
+}
@@ -0,0 +1,97 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <getopt.h>
+
+#include "pgn.h"
+#include "record.h"
+
+/* Game record tool: converts between PGN and binary game records, and replays record files.
+
+    records games.pgn -o games.rec   converts every game of a PGN file to a record file (appending to it)
+    records games.rec -o games.pgn   converts a record file to PGN
+    records games.rec                replays every game of a record file and reports what was read
+*/
+
+int main(int argc, char * argv[]) {
+    const char * output = NULL;
+
+    int opt;
+    while((opt = getopt(argc, argv, "o:")) != -1) {
+        switch(opt) {
+            case 'o':
+                output = optarg;
+                break;
+            default:
+                optind = argc;
+        }
+    }
+    if(optind != argc - 1) {
+        std::cerr << "Usage: records [options] file\n";
+        std::cerr << "-o file : convert the PGN or record file to a record file or PGN <file>" << std::endl;
+        return EXIT_FAILURE;
+    }
+    const char * input = argv[optind];
+
+    const auto start = std::chrono::steady_clock::now();
+    uint64_t games = 0, plies = 0, errors = 0;
+    Board board;
+
+    if(!GameRecordFile::identify(input)) {
+        // PGN to records
+        PgnFile file(input);
+        GameRecordWriter writer;
+        if(!file.isOpen()) {
+            std::cerr << "Could not open PGN file '" << input << "'\n";
+            return EXIT_FAILURE;
+        }
+        if(!output || !writer.open(output)) {
+            std::cerr << "Could not open record file '" << (output ? output : "") << "'\n";
+            return EXIT_FAILURE;
+        }
+
+        std::string_view text = file.text();
+        PgnGame game;
+        std::vector<Move> moves;
+        while(PgnFile::next(text, game)) {
+            games++;
+            moves.clear();
+            std::string_view fen = game.tag("FEN"), error;
+            const int n = board.setPosition(fen.empty() ? STARTING_FEN : fen) ? replay(board, game, [&](Move& move, std::string_view) { moves.push_back(move); }, error) : -1;
+            if(n < 0 || !writer.write(fen, moves, game.result())) errors++;
+            else plies += n;
+        }
+    } else {
+        // records to PGN (or just replay)
+        GameRecordFile file(input);
+        std::ofstream pgn;
+        if(!file.isOpen()) {
+            std::cerr << "Could not open record file '" << input << "'\n";
+            return EXIT_FAILURE;
+        }
+        if(output && !(pgn.open(output), pgn)) {
+            std::cerr << "Could not open PGN file '" << output << "'\n";
+            return EXIT_FAILURE;
+        }
+
+        GameRecord game;
+        std::vector<Move> moves;
+        while(file.next(game)) {
+            games++;
+            moves.clear();
+            const int n = output ? replay(board, game, [&](Move& move) { moves.push_back(move); }, true) : replay(board, game, [](Move&) {});
+            if(n < 0) errors++;
+            else {
+                plies += n;
+                if(output) writePgn(pgn, game.fen, moves, game.result);
+            }
+        }
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("games:   %lu (%lu could not be replayed)\n", games, errors);
+    printf("plies:   %lu\n", plies);
+    printf("time:    %.2fs (%.0f games/s, %.0f plies/s)\n", seconds, games / seconds, plies / seconds);
+
+    return 0;
+}
@@ -0,0 +1,572 @@
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <vector>
+
+#include "board.h"
+#include "clock.h"
+#include "interleave.h"
+#include "nnue.h"
+#include "random.h"
+#include "stats.h"
+#include "tablebase.h"
+#include "trace.h"
+#include "transposition.h"
+
+// number of positions stored in the transposition table (unless it is mapped from a file of another size)
+#define NPOSITIONS 32500
+
+// `bestLine` margin that disables the random choice of move
+#define RANDOM_MARGIN_OFF -1
+
+// maximum depth of a timed search
+#define MAX_DEPTH 64
+
+// number of nodes between checks of the clock during a timed search
+#define POLL_INTERVAL 1024
+
+// move ordering scores (the transposition table's best move first, then captures that don't lose material by their
+// static exchange evaluation, then quiet moves by their history score and finally losing captures)
+#define ORDER_BEST INT_MAX
+#define ORDER_CAPTURE (1 << 30)
+
+// depth (in plies above the horizon) up to which quiet moves that lose material are skipped
+#define SEE_PRUNE_DEPTH 1
+
+// a line of play found by a multi-PV search
+struct Line {
+    int evaluation; // evaluation of the line's first move
+    unsigned int depth; // depth of the search that found the line
+    std::vector<Move> moves; // the moves expected to be played (with their algebraic descriptions)
+};
+
+// state shared by the searches of one engine (transposition table, move ordering history and tablebases), kept apart from
+// the position so that boards stay small values that can be copied freely
+class SearchContext {
+public:
+    TranspositionTable transpositionTable; // transposition table (in memory or mapped from a file)
+    uint32_t history[2][6][9][9]; // history heuristic scores of quiet moves by color, piece type and target square
+    SearchStats stats; // statistics collected during the most recent search
+    Random random; // generator used to choose between equally good moves (seedable for reproducible games)
+    int randomMargin = 0; // moves within this many centipawns of the best move are chosen at random (RANDOM_MARGIN_OFF: never)
+    std::shared_ptr<Tablebases> tablebases; // endgame tablebases (optional)
+    std::shared_ptr<const Network> network; // neural network evaluation (optional, replaces the heuristic evaluation)
+    std::vector<Accumulator> accumulators; // the network's accumulators for the positions in the current line, indexed by ply
+    MaterialTable materials; // material configurations evaluated so far
+    std::unique_ptr<SearchTrace> trace; // records the nodes searched (optional)
+    SearchLane lane; // where the context's own searches run (straight through, without giving way to other lanes)
+
+    Time deadline = Time::max(); // time at which the search in progress is aborted
+    bool stopped = false; // whether the search in progress was aborted (its results are then meaningless)
+    uint32_t polls = 0; // nodes since the clock was last checked
+
+    SearchContext() : transpositionTable(NPOSITIONS) {
+        memset(history, 0, sizeof(history));
+    }
+
+    // look up the position in the endgame tablebases - returns true if the position is covered
+    bool probeTablebases(const Board& board, int& evaluation) const {
+        if(!tablebases) return false;
+
+        // tables don't include castling rights or en passant captures
+        const GameState& state = board.state();
+        if(state.passant || state.canCastle[WHITE][Board::Side::QUEEN] || state.canCastle[WHITE][Board::Side::KING]
+            || state.canCastle[BLACK][Board::Side::QUEEN] || state.canCastle[BLACK][Board::Side::KING])
+            return false;
+
+        TbPiece pieces[TB_PIECES];
+        int n = 0;
+        for(PieceColor color : {WHITE, BLACK}) {
+            for(PieceType type : PIECE_TYPES) {
+                for(Coord location : board.remaining[color][type]) {
+                    if(n == TB_PIECES) return false;
+                    pieces[n++] = {color, type, TB_SQUARE(location.file, location.rank)};
+                }
+            }
+        }
+
+        uint8_t value;
+        if(!tablebases->probe(pieces, n, board.toPlay, value)) return false;
+
+        // convert distance to mate in plies into the engine's "mate in n moves" encoding
+        if(value == TB_DRAW) evaluation = 0;
+        else evaluation = MATE_IN(TB_IS_WIN(value) ? board.toPlay : !board.toPlay, (TB_PLIES(value) + 1) / 2);
+        return true;
+    }
+
+    // whether the search in progress has to be aborted (checks the clock every POLL_INTERVAL nodes)
+    bool aborted() {
+        if(!stopped && ++polls == POLL_INTERVAL) {
+            polls = 0;
+            stopped = std::chrono::steady_clock::now() >= deadline;
+        }
+        return stopped;
+    }
+
+    // use `network` to evaluate heuristic nodes (or the heuristic evaluation if it is null)
+    void setNetwork(std::shared_ptr<const Network> network) {
+        this->network = network;
+        accumulators.assign(network ? MAX_PLIES : 0, Accumulator());
+    }
+
+    // evaluate a heuristic or terminal node (the network is only used for games in progress outside of known endings)
+    int evaluate(Board& board) {
+        const MaterialEntry& material = materials[board.state().material];
+        if(!network || board.result != GameResult::IN_PROGRESS) return board.evaluate(material);
+
+        int evaluation;
+        if(board.evaluateEnding(material, evaluation)) return evaluation;
+        return network->evaluate(board, accumulators.data());
+    }
+
+    // evaluate a position using minimax to depth `depth`
+    int evaluatePosition(Board& board, PieceColor color, int alpha, int beta, unsigned int depth) {
+        return run(board, positionTask(lane, color, alpha, beta, depth));
+    }
+
+    // quiescence search: extend the search beyond the horizon with captures (and promotions) that don't lose material
+    // until the position is quiet, so that heuristic evaluations aren't taken in the middle of an exchange. The side to
+    // play may also "stand pat" and accept the static evaluation instead of capturing
+    int quiesce(Board& board, PieceColor color, int alpha, int beta) {
+        STAT(stats.qnodes++);
+        if(aborted()) return 0;
+
+        int evaluation = evaluate(board);
+        if(board.result != GameResult::IN_PROGRESS || board.ply + 2 >= MAX_PLIES) return evaluation;
+        if(color ? (evaluation <= alpha) : (evaluation >= beta)) return evaluation;
+        if(color) beta = std::min(beta, evaluation);
+        else alpha = std::max(alpha, evaluation);
+
+        // captures and promotions that win or keep material, best first
+        std::list<Move> moves;
+        for(Move& move : board.getPseudoLegalMoves(color)) {
+            if(move.captureType == CaptureType::NONE && move.moveType != MoveType::PROMOTION) continue;
+            if((move.evaluation = board.see(move)) < 0) {
+                STAT(stats.seePrunes++);
+                continue;
+            }
+            if(board.legal(color, move)) moves.push_back(move);
+        }
+        moves.sort([](const Move& m1, const Move& m2) { return m1.evaluation > m2.evaluation; });
+
+        for(Move& move : moves) {
+            board.move(color, move);
+            const int score = quiesce(board, !color, alpha, beta);
+            board.unmove(move);
+            if(stopped) return 0;
+
+            if(BETTER(color, score, evaluation)) evaluation = score;
+            if(color ? (evaluation <= alpha) : (evaluation >= beta)) break;
+            if(color) beta = std::min(beta, evaluation);
+            else alpha = std::max(alpha, evaluation);
+        }
+
+        return evaluation;
+    }
+
+    // evaluate a move using a minimax approach
+    int evaluateMove(Board& board, Move& move, int alpha, int beta, unsigned int depth) {
+        return run(board, moveTask(lane, move, alpha, beta, depth));
+    }
+
+    // returns the best line in the position for `color` by performing a search to depth `depth`. With a `margin` of zero or
+    // more, one of the moves within `margin` of the best move is chosen at random instead. The line is empty if `color`
+    // has no legal moves
+    Line bestLine(Board& board, PieceColor color, unsigned int depth, int margin = RANDOM_MARGIN_OFF) {
+        stats.reset();
+        memset(history, 0, sizeof(history));
+
+        return choose(board, searchRoot(board, color, depth, margin), margin, depth);
+    }
+
+    // returns the best line in the position for `color` by an iterative deepening search (up to depth `depth`) that lasts as
+    // long as `time` allows. If the hard limit interrupts an iteration, the line found by the previous one is used
+    Line bestLine(Board& board, PieceColor color, unsigned int depth, TimeManager& time) {
+        stats.reset();
+        memset(history, 0, sizeof(history));
+
+        // moves within DOMINANCE_MARGIN of the best move are evaluated exactly to tell the time manager whether it dominates
+        const int margin = std::max(randomMargin, DOMINANCE_MARGIN);
+        const bool forced = board.getLegalMoves(color).size() == 1;
+        std::vector<Move> candidates;
+        unsigned int completed = 0;
+        for(unsigned int iteration = 1; iteration <= depth; iteration++) {
+            std::vector<Move> found = searchRoot(board, color, iteration, margin);
+            if(stopped || found.empty()) break;
+            candidates = found;
+            completed = iteration;
+
+            if(forced || IS_MATE(candidates.front().evaluation) || !time.next(iteration, candidates.front(), candidates.size() - 1)) break;
+            deadline = time.deadline(); // the first iteration always completes
+        }
+
+        deadline = Time::max();
+        stopped = false;
+
+        return choose(board, candidates, randomMargin, completed);
+    }
+
+    // returns the `count` best lines in the position for `color` (best first) using iterative deepening to depth `depth`.
+    // Each iteration finds the lines one at a time by searching the root moves that don't begin a line found so far, so
+    // each line costs a single search (sharing the transposition table) instead of one search per legal move. The search
+    // stops at `deadline` (the first iteration always completes), returning the lines of the last completed iteration
+    std::vector<Line> bestLines(Board& board, PieceColor color, unsigned int depth, size_t count, Time deadline = Time::max()) {
+        std::vector<Line> lines, previous;
+
+        stats.reset();
+        memset(history, 0, sizeof(history));
+
+        std::list<Move> moves = board.getLegalMoves(color);
+        for(unsigned int iteration = 1; iteration <= depth && !stopped; iteration++) {
+            previous.swap(lines);
+            lines.clear();
+            std::list<Move> remaining = moves;
+            while(lines.size() < count && !remaining.empty() && !stopped) {
+                TRACE(if(trace) trace->search(board, iteration));
+                int alpha = INT_MIN, beta = INT_MAX;
+                std::list<Move>::iterator best = remaining.end();
+                for(std::list<Move>::iterator move = remaining.begin(); move != remaining.end() && !stopped; move++) {
+                    const int evaluation = evaluateMove(board, *move, alpha, beta, iteration - 1);
+                    if(best == remaining.end() || BETTER(color, evaluation, best->evaluation)) best = move;
+                    if(color) beta = std::min(beta, evaluation);
+                    else alpha = std::max(alpha, evaluation);
+                }
+                if(stopped) break;
+
+                lines.push_back({best->evaluation, iteration, principalVariation(board, *best, iteration)});
+                remaining.erase(best);
+            }
+            if(stopped) break;
+
+            stats.iteration(iteration);
+            this->deadline = deadline;
+
+            // search the best lines first in the next iteration
+            moves.clear();
+            for(const Line& line : lines) moves.push_back(line.moves.front());
+            moves.splice(moves.end(), remaining);
+        }
+
+        if(stopped) lines.swap(previous);
+        this->deadline = Time::max();
+        stopped = false;
+
+        return lines;
+    }
+
+    // returns the best line (as bestLine() with RANDOM_MARGIN_OFF would) for the side to play in each of `count` positions,
+    // searched to depth `depth` by `lanes` interleaved searches (see interleave.h) that share the context. `setup(i, board)`
+    // sets up position i on `board` and returns false if it can't, in which case its line is empty (as it is if the game
+    // is over). The trace, which can't tell the searches apart, is left out
+    template<typename Setup>
+    std::vector<Line> interleavedBestLines(size_t count, unsigned int depth, Setup setup, unsigned int lanes = INTERLEAVE_LANES) {
+        std::vector<Line> lines(count);
+        std::vector<Board> boards(std::max(lanes, 1u));
+        std::unique_ptr<SearchTrace> detached = std::move(trace);
+
+        stats.reset();
+        memset(history, 0, sizeof(history));
+
+        // start searching the next position in `lane` - returns false if there are none left
+        size_t next = 0;
+        auto start = [&](SearchLane& lane) {
+            lane.root = SearchTask(); // (frees the previous search's frame first)
+            while(next < count) {
+                lane.index = next++;
+                if(!setup(lane.index, *lane.board) || lane.board->result != GameResult::IN_PROGRESS) continue;
+                lane.root = rootTask(lane, lane.board->toPlay, depth, RANDOM_MARGIN_OFF, lane.candidates);
+                lane.suspended = lane.root.start();
+                return true;
+            }
+            return false;
+        };
+
+        std::vector<std::unique_ptr<SearchLane>> running;
+        for(Board& board : boards) {
+            running.push_back(std::make_unique<SearchLane>());
+            running.back()->board = &board;
+            running.back()->interleaved = true;
+            if(network) running.back()->accumulators.assign(MAX_PLIES, Accumulator());
+            if(!start(*running.back())) {
+                running.pop_back();
+                break;
+            }
+        }
+
+        // resume the lanes in turn, each running until its next transposition table probe or the end of its search
+        for(size_t i = 0; !running.empty(); ) {
+            SearchLane& lane = *running[i];
+            accumulators.swap(lane.accumulators);
+            lane.suspended.resume();
+            accumulators.swap(lane.accumulators);
+
+            if(lane.root.done()) {
+                if(!lane.candidates.empty()) {
+                    const Move& best = lane.candidates.front();
+                    lines[lane.index] = {best.evaluation, depth, principalVariation(*lane.board, best, depth)};
+                }
+                if(!start(lane)) {
+                    running.erase(running.begin() + i);
+                    if(i == running.size()) i = 0;
+                    continue;
+                }
+            }
+            if(++i == running.size()) i = 0;
+        }
+
+        stats.iteration(depth);
+        trace = std::move(detached);
+
+        return lines;
+    }
+
+private:
+    // record leaving the current node of positionTask() in the trace (if any) - returns `score`
+    int leave(const Board& board, int score, TraceReason reason, bool hit = false) {
+        TRACE(if(trace) trace->exit(board, score, reason, hit));
+        return score;
+    }
+
+    // whether the transposition table entry `position` of a node settles it: the entry was searched at least to `depth` and
+    // its evaluation is exact or a bound that already falls outside the window (`alpha`, `beta`)
+    static bool settles(const Position& position, int alpha, int beta, unsigned int depth) {
+        if(position.depth < depth) return false;
+        if(position.bound == LOWER) return position.evaluation >= beta;
+        if(position.bound == UPPER) return position.evaluation <= alpha;
+        return true;
+    }
+
+    // run `task`, a search of `board` in the context's own lane (which never gives way), to its end - returns its evaluation
+    int run(Board& board, SearchTask task) {
+        lane.board = &board;
+        task.start().resume();
+        return task.evaluation();
+    }
+
+    // a node of the search: evaluate the position on the lane's board using minimax to depth `depth`. In an interleaved
+    // search the other lanes run while the position's transposition table entry is fetched from memory
+    SearchTask positionTask(SearchLane& lane, PieceColor color, int alpha, int beta, unsigned int depth) {
+        Board& board = *lane.board;
+        STAT(stats.nodes++);
+        TRACE(if(trace) trace->enter(board, alpha, beta, depth));
+        if(aborted()) co_return leave(board, 0, TraceReason::ABORTED);
+
+        // perfect information from the endgame tablebases
+        int evaluation = 0;
+        if(board.result == GameResult::IN_PROGRESS && probeTablebases(board, evaluation)) {
+            STAT(stats.tbHits++);
+            co_return leave(board, evaluation, TraceReason::TABLEBASE);
+        }
+
+        // evaluate heuristic node (dead draws end the game as soon as move() finds them, so they aren't searched any deeper)
+        if(board.result != GameResult::IN_PROGRESS) co_return leave(board, evaluate(board), TraceReason::TERMINAL);
+        // (the horizon is also reached when the state array has no room left for a move and a reply)
+        if(depth == 0 || board.ply + 2 >= MAX_PLIES) co_return leave(board, quiesce(board, color, alpha, beta), TraceReason::HORIZON);
+
+        // look up a position in the transposition table
+        const uint64_t hash = board.hash();
+        Position& position = transpositionTable[hash];
+        co_await Prefetch{&position, lane};
+        const bool hit = position.key == hash;
+        STAT(stats.ttProbes++);
+        STAT(if(hit) stats.ttHits++);
+        if(hit && settles(position, alpha, beta, depth)) {
+            STAT(stats.ttCutoffs++);
+            co_return leave(board, position.evaluation, TraceReason::TT_CUTOFF, true);
+        }
+
+        // order moves
+        std::list<Move> moves = board.getLegalMoves(color);
+        order(board, moves, color, hit ? &position.bestMove : NULL);
+
+        // evaluate the current position, with the loops of both players in one (a cutoff is a move that's too good for the
+        // opponent to allow). The window narrows as moves are searched, but the stored evaluation is only exact if it lies
+        // inside the window the node was entered with
+        const int entryAlpha = alpha, entryBeta = beta;
+        Move best;
+        Move * cutoff = NULL;
+        const bool check = board.inCheck(color);
+        bool searched = false;
+        STAT(bool first = true);
+        evaluation = color ? INT_MAX : INT_MIN;
+        for(Move& move : moves) {
+            if(searched && prune(board, move, check, depth)) continue;
+            co_await moveTask(lane, move, alpha, beta, depth - 1);
+            if(stopped) co_return leave(board, 0, TraceReason::ABORTED, hit);
+            searched = true;
+            if(BETTER(color, move.evaluation, evaluation)) {
+                best = move;
+                evaluation = move.evaluation;
+            }
+            if(color ? (evaluation <= alpha) : (evaluation >= beta)) {
+                STAT(stats.betaCutoffs++; stats.firstMoveCutoffs += first);
+                cutoff = &move;
+                break;
+            }
+            if(color) beta = std::min(beta, evaluation);
+            else alpha = std::max(alpha, evaluation);
+            STAT(first = false);
+        }
+
+        // quiet moves that cause cutoffs are tried earlier in other positions
+        if(cutoff && cutoff->captureType == CaptureType::NONE)
+            history[color][cutoff->piece.type][cutoff->to.rank][cutoff->to.file] += depth * depth;
+
+        // write to transposition table (all of the entry at once: while the moves were searched, other positions - of this
+        // lane or, when interleaved, of another - may have claimed it)
+        position.key = hash;
+        position.bestMove = best;
+        position.evaluation = evaluation;
+        position.depth = depth;
+        position.bound = (evaluation >= entryBeta) ? LOWER : (evaluation <= entryAlpha) ? UPPER : EXACT;
+
+        co_return leave(board, evaluation, cutoff ? TraceReason::CUTOFF : TraceReason::SEARCHED, hit);
+    }
+
+    // a node of the search for a move: make `move` on the lane's board and evaluate the resulting position - returns its
+    // evaluation, which is also stored in `move`
+    SearchTask moveTask(SearchLane& lane, Move& move, int alpha, int beta, unsigned int depth) {
+        Board& board = *lane.board;
+
+        // do move
+        const PieceColor color = move.piece.color;
+        board.move(color, move);
+
+        // evaluate resulting position
+        move.evaluation = co_await positionTask(lane, !color, alpha, beta, depth);
+        if(IS_MATE(move.evaluation) && EVAL_COLOR(move.evaluation) == color) color ? move.evaluation++ : move.evaluation--; // if results in checkmate, increment mate counter
+
+        // undo move
+        board.unmove(move);
+
+        co_return move.evaluation;
+    }
+
+    // search the root moves to depth `depth`. Alpha is carried across the moves, so only the moves that can still be the
+    // best are searched with an open window. With a `margin` of zero or more the window is widened by `margin` so that
+    // every move within `margin` of the best move is evaluated exactly - sets `candidates` to these moves (or just the best
+    // move if `margin` is negative), best first, and returns the best evaluation. `candidates` is left empty if there are no
+    // legal moves or the search is aborted
+    SearchTask rootTask(SearchLane& lane, PieceColor color, unsigned int depth, int margin, std::vector<Move>& candidates) {
+        Board& board = *lane.board;
+        candidates.clear();
+        TRACE(if(trace) trace->search(board, depth));
+        const uint64_t hash = board.hash();
+        Position& position = transpositionTable[hash];
+        co_await Prefetch{&position, lane};
+        std::list<Move> moves = board.getLegalMoves(color);
+        order(board, moves, color, (position.key == hash) ? &position.bestMove : NULL);
+        if(moves.empty()) co_return 0;
+
+        int bestEvaluation = color ? INT_MAX : INT_MIN;
+        Move * best = NULL;
+        for(Move& move : moves) {
+            // moves that can't come within `margin` of the best move are only searched for a refutation
+            const int64_t bound = (int64_t) bestEvaluation + (color ? 1 : -1) * ((int64_t) std::max(margin, 0) + (margin >= 0));
+            const int alpha = color ? INT_MIN : (int) std::max<int64_t>(bound, INT_MIN);
+            const int beta = color ? (int) std::min<int64_t>(bound, INT_MAX) : INT_MAX;
+
+            const int evaluation = co_await moveTask(lane, move, alpha, beta, depth - 1);
+            if(stopped) co_return 0;
+            if(!best || BETTER(color, evaluation, bestEvaluation)) {
+                best = &move;
+                bestEvaluation = evaluation;
+            }
+        }
+
+        // the best move is searched first in the next iteration
+        position.key = hash;
+        position.bestMove = *best;
+        position.evaluation = bestEvaluation;
+        position.depth = depth;
+        position.bound = EXACT;
+
+        candidates.push_back(*best);
+        for(Move& move : moves) {
+            const int64_t loss = color ? (int64_t) move.evaluation - bestEvaluation : (int64_t) bestEvaluation - move.evaluation;
+            if(&move != best && loss <= margin) candidates.push_back(move);
+        }
+        std::stable_sort(candidates.begin() + 1, candidates.end(), [color](const Move& m1, const Move& m2) { return BETTER(color, m1.evaluation, m2.evaluation); });
+
+        co_return bestEvaluation;
+    }
+
+    // rootTask() run in the context's own lane - returns the candidates (empty if the search was aborted)
+    std::vector<Move> searchRoot(Board& board, PieceColor color, unsigned int depth, int margin) {
+        std::vector<Move> candidates;
+        run(board, rootTask(lane, color, depth, margin, candidates));
+        if(!stopped) stats.iteration(depth);
+        return candidates;
+    }
+
+    // choose one of the `candidates` (best first) that are within `margin` of the best move at random (only ties are
+    // considered if the best move mates), or the best move if `margin` is negative - returns its line (at most `length` moves),
+    // which is empty if there are no candidates (the side to play has no legal moves)
+    Line choose(Board& board, const std::vector<Move>& candidates, int margin, unsigned int length) {
+        if(candidates.empty()) return {};
+
+        const Move& best = candidates.front();
+        size_t n = 1;
+        if(margin >= 0) {
+            while(n < candidates.size()) {
+                const Move& move = candidates[n];
+                const int64_t loss = std::abs((int64_t) move.evaluation - best.evaluation);
+                if(loss > (IS_MATE(best.evaluation) ? 0 : margin)) break;
+                n++;
+            }
+        }
+
+        const Move& move = candidates[(margin >= 0) ? random.below(n) : 0];
+        return {move.evaluation, length, principalVariation(board, move, length)};
+    }
+
+    // returns the line beginning with `move` that the transposition table predicts (at most `length` moves)
+    std::vector<Move> principalVariation(Board& board, Move move, unsigned int length) {
+        std::vector<Move> line;
+        while(true) {
+            board.toAlgebraic(move, move.algebraic);
+            board.move(move.piece.color, move);
+            line.push_back(move);
+            if(line.size() >= length || board.result != GameResult::IN_PROGRESS) break;
+
+            // follow the stored best move if it is legal in this position
+            const Position& position = transpositionTable[board.hash()];
+            if(position.key != board.hash()) break;
+            std::list<Move> moves = board.getLegalMoves(board.toPlay);
+            std::list<Move>::iterator next = std::find(moves.begin(), moves.end(), position.bestMove);
+            if(next == moves.end()) break;
+            move = *next;
+        }
+
+        for(std::vector<Move>::reverse_iterator played = line.rbegin(); played != line.rend(); played++) board.unmove(*played);
+        return line;
+    }
+
+    // whether `move` can be skipped near the horizon (a quiet move that doesn't give check and loses material by
+    // static exchange evaluation, when the side to play isn't in check)
+    bool prune(const Board& board, const Move& move, bool check, unsigned int depth) {
+        if(depth > SEE_PRUNE_DEPTH || check || move.check) return false;
+        if(move.captureType != CaptureType::NONE || move.moveType != MoveType::NORMAL) return false;
+        if(board.see(move) >= 0) return false;
+
+        STAT(stats.seePrunes++);
+        return true;
+    }
+
+    // sort `moves` so that the most promising moves are searched first (the evaluation fields are overwritten by the search)
+    void order(const Board& board, std::list<Move>& moves, PieceColor color, const Move * bestMove) const {
+        for(Move& move : moves) {
+            if(bestMove && move == *bestMove) move.evaluation = ORDER_BEST;
+            else if(move.captureType != CaptureType::NONE) {
+                const int see = board.see(move);
+                move.evaluation = (see >= 0) ? ORDER_CAPTURE + see : see;
+            }
+            else move.evaluation = std::min<uint32_t>(history[color][move.piece.type][move.to.rank][move.to.file], ORDER_CAPTURE - 1);
+        }
+        moves.sort([](const Move& m1, const Move& m2) { return m1.evaluation > m2.evaluation; });
+    }
+};
@@ -0,0 +1,371 @@
+#pragma once
+
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "board.h"
+#include "search.h"
+
+/* Analysis server: answers line-delimited JSON requests on a Unix domain socket (or on stdin/stdout), e.g.
+
+        {"id": 1, "fen": "<fen>", "moves": ["e4", "e5"], "depth": 8, "movetime": 500, "multipv": 3}
+
+    where every field is optional (the position defaults to the starting position, the depth to DEFAULT_ANALYSIS_DEPTH
+    if there is no time limit and to MAX_DEPTH otherwise, and the number of lines to 1). Each request is answered with a
+    line such as
+
+        {"id": 1, "lines": [{"depth": 8, "cp": 35, "pv": ["Nf3", "Nc6"]}, ...], "stats": {...}}
+
+    with mate scores given as {"mate": n} (positive if white mates), or {"id": 1, "error": "..."}.
+
+    A batch of positions is searched to a fixed depth (DEFAULT_ANALYSIS_DEPTH unless given) by interleaved searches (see
+    interleave.h), which is much faster than a request per position when the searches are shallow:
+
+        {"id": 2, "positions": ["<fen>", "<fen>", ...], "depth": 3}
+        {"id": 2, "results": [{"depth": 3, "cp": 35, "pv": ["Nf3", "Nc6", "d4"]}, {"error": "invalid FEN"}, ...], "stats": {...}}
+
+    Requests are answered by a pool of workers, each with its own board and search context. A client is served by the same
+    worker for as long as it stays connected, so its transposition table stays warm across the related queries of a game
+    (and answers arrive in the order of the requests).
+*/
+
+// search depth when a request specifies neither depth nor time limit
+#define DEFAULT_ANALYSIS_DEPTH 4
+
+// longest request line a client may send (enough for a batch of tens of thousands of positions) - a client whose line
+// grows beyond it is disconnected
+#define MAX_REQUEST_SIZE (4 * 1024 * 1024)
+
+// a parsed analysis request
+struct AnalysisRequest {
+    std::string id = "null"; // request identifier (echoed verbatim as JSON)
+    std::string fen = STARTING_FEN;
+    std::vector<std::string> moves; // moves played from `fen`
+    std::vector<std::string> positions; // positions of a batch (instead of `fen` and `moves`)
+    unsigned int depth = 0; // maximum depth (0 if not specified)
+    unsigned int movetime = 0; // time limit in milliseconds (0 if not specified)
+    unsigned int multipv = 1; // number of lines
+
+    // parse a flat JSON object - returns false (with a description in `error`) if `text` is malformed
+    bool parse(std::string_view text, std::string& error) {
+        size_t i = 0;
+        auto skip = [&]() { while(i < text.size() && isspace((unsigned char) text[i])) i++; };
+        auto expect = [&](char c) { skip(); if(i < text.size() && text[i] == c) { i++; return true; } return false; };
+        auto string = [&](std::string& value) {
+            if(!expect('"')) return false;
+            value.clear();
+            for(; i < text.size() && text[i] != '"'; i++) {
+                if(text[i] == '\\' && ++i == text.size()) return false;
+                value += text[i];
+            }
+            return i++ < text.size();
+        };
+        auto number = [&](unsigned int& value) {
+            skip();
+            if(i == text.size() || !isdigit((unsigned char) text[i])) return false;
+            for(value = 0; i < text.size() && isdigit((unsigned char) text[i]); i++) value = std::min(10 * value + (text[i] - '0'), 1000000000u);
+            return true;
+        };
+        auto strings = [&](std::vector<std::string>& values) {
+            if(!expect('[')) return false;
+            if(expect(']')) return true;
+            do {
+                values.emplace_back();
+                if(!string(values.back())) return false;
+            } while(expect(','));
+            return expect(']');
+        };
+
+        if(!expect('{')) return error = "expected an object", false;
+        if(expect('}')) return true;
+        do {
+            std::string key;
+            if(!string(key) || !expect(':')) return error = "expected a key", false;
+
+            skip();
+            bool ok;
+            if(key == "id") {
+                // any string or number, kept as written
+                const size_t start = i;
+                std::string value;
+                unsigned int n;
+                ok = (i < text.size() && text[i] == '"') ? string(value) : number(n);
+                if(ok) id = text.substr(start, i - start);
+            }
+            else if(key == "fen") ok = string(fen);
+            else if(key == "moves") ok = strings(moves);
+            else if(key == "positions") ok = strings(positions);
+            else if(key == "depth") ok = number(depth);
+            else if(key == "movetime") ok = number(movetime);
+            else if(key == "multipv") ok = number(multipv) && multipv > 0;
+            else return error = "unknown field", false;
+            if(!ok) return error = "invalid value for '" + key + "'", false;
+        } while(expect(','));
+
+        if(!expect('}')) return error = "expected '}'", false;
+        skip();
+        if(i != text.size()) return error = "trailing characters", false;
+        return true;
+    }
+};
+
+// a worker of the analysis server: answers the requests queued for it in order, with a persistent board and search context
+class AnalysisWorker {
+private:
+    // a request line to answer on `fd` (or, if `close` is set, a client to disconnect after its earlier requests)
+    struct Job {
+        int fd;
+        std::string line;
+        bool close;
+    };
+
+    Board board;
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<Job> jobs;
+    bool done = false;
+    std::thread thread;
+
+    // `text` as a JSON string (with quotes, backslashes and control characters escaped)
+    static std::string quoted(std::string_view text) {
+        std::string string = "\"";
+        for(const char c : text) {
+            if(c == '"' || c == '\\') string += '\\';
+            if((unsigned char) c >= 0x20) string += c;
+            else {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned char) c);
+                string += escaped;
+            }
+        }
+        return string + "\"";
+    }
+
+    // write `line` as a JSON object's fields (without the braces)
+    static void writeLine(std::stringstream& stream, const Line& line) {
+        stream << "\"depth\":" << line.depth << ",";
+        if(IS_MATE(line.evaluation)) stream << "\"mate\":" << (line.evaluation > 0 ? 1 : -1) * MATE(line.evaluation);
+        else stream << "\"cp\":" << line.evaluation;
+        stream << ",\"pv\":[";
+        for(size_t j = 0; j < line.moves.size(); j++) stream << (j ? ",\"" : "\"") << line.moves[j].algebraic << "\"";
+        stream << "]";
+    }
+
+    // returns the JSON answer to the batch request `request`
+    std::string answerBatch(const AnalysisRequest& request, const std::string& id) {
+        if(request.movetime) return id + ",\"error\":\"batches can't have a time limit\"}";
+
+        const unsigned int depth = request.depth ? std::min(request.depth, (unsigned int) MAX_DEPTH) : DEFAULT_ANALYSIS_DEPTH;
+        std::vector<bool> valid(request.positions.size());
+        const std::vector<Line> lines = search.interleavedBestLines(request.positions.size(), depth, [&](size_t i, Board& board) {
+            return valid[i] = board.setPosition(request.positions[i]);
+        });
+
+        std::stringstream stream;
+        stream << id << ",\"results\":[";
+        for(size_t i = 0; i < lines.size(); i++) {
+            stream << (i ? ",{" : "{");
+            if(!valid[i]) stream << "\"error\":\"invalid FEN\"";
+            else if(lines[i].moves.empty()) stream << "\"error\":\"the game is over\"";
+            else writeLine(stream, lines[i]);
+            stream << "}";
+        }
+        stream << "],\"stats\":" << search.stats.json() << "}";
+        return stream.str();
+    }
+
+    // returns the JSON answer to the request `line`
+    std::string answer(const std::string& line) {
+        AnalysisRequest request;
+        std::string error;
+        if(!request.parse(line, error)) return "{\"id\":" + request.id + ",\"error\":" + quoted(error) + "}";
+        const std::string id = "{\"id\":" + request.id;
+        if(!request.positions.empty()) return answerBatch(request, id);
+
+        if(!board.setPosition(request.fen)) return id + ",\"error\":\"invalid FEN\"}";
+        for(const std::string& text : request.moves) {
+            Move move;
+            if(board.result != GameResult::IN_PROGRESS || !board.parseMove(board.toPlay, text, move)) return id + ",\"error\":\"illegal move\"}";
+        }
+        if(board.result != GameResult::IN_PROGRESS) return id + ",\"error\":\"the game is over\"}";
+
+        const unsigned int depth = request.depth ? std::min(request.depth, (unsigned int) MAX_DEPTH) : request.movetime ? MAX_DEPTH : DEFAULT_ANALYSIS_DEPTH;
+        const Time deadline = request.movetime ? std::chrono::steady_clock::now() + Milliseconds(request.movetime) : Time::max();
+        const std::vector<Line> lines = search.bestLines(board, board.toPlay, depth, request.multipv, deadline);
+
+        std::stringstream stream;
+        stream << id << ",\"lines\":[";
+        for(size_t i = 0; i < lines.size(); i++) {
+            stream << (i ? ",{" : "{");
+            writeLine(stream, lines[i]);
+            stream << "}";
+        }
+        stream << "],\"stats\":" << search.stats.json() << "}";
+        return stream.str();
+    }
+
+    void run() {
+        while(true) {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [this] { return done || !jobs.empty(); });
+            if(jobs.empty()) return;
+            Job job = std::move(jobs.front());
+            jobs.pop_front();
+            lock.unlock();
+
+            if(job.close) {
+                close(job.fd);
+                continue;
+            }
+
+            // write the whole answer (a client that has gone away is simply ignored)
+            const std::string response = answer(job.line) + "\n";
+            for(size_t written = 0; written < response.size(); ) {
+                const ssize_t n = write(job.fd, response.data() + written, response.size() - written);
+                if(n <= 0) break;
+                written += n;
+            }
+        }
+    }
+
+    void push(Job job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(job));
+        }
+        ready.notify_one();
+    }
+
+public:
+    SearchContext search;
+    size_t clients = 0; // number of clients assigned to the worker
+
+    AnalysisWorker() = default;
+    AnalysisWorker(const AnalysisWorker&) = delete;
+
+    ~AnalysisWorker() { stop(); }
+
+    void start() { thread = std::thread(&AnalysisWorker::run, this); }
+
+    // finish the queued requests and end the worker's thread
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+        }
+        ready.notify_one();
+        if(thread.joinable()) thread.join();
+    }
+
+    // answer the request `line` on `fd`
+    void request(int fd, std::string line) { push({fd, std::move(line), false}); }
+
+    // close `fd` once the requests queued before are answered
+    void disconnect(int fd) { push({fd, "", true}); }
+};
+
+class AnalysisServer {
+private:
+    std::vector<std::unique_ptr<AnalysisWorker>> workers;
+
+public:
+    AnalysisServer(unsigned int threads) {
+        for(unsigned int i = 0; i < std::max(threads, 1u); i++) workers.push_back(std::make_unique<AnalysisWorker>());
+    }
+
+    // give every worker the same engine configuration (tablebases, network and transposition table size) as `prototype`,
+    // and the first worker (the one answering stdin) the transposition table in the file at `hashPath` if there is one -
+    // the workers search concurrently, so they can't share a mapped table. Returns false if the file can't be opened
+    bool configure(const SearchContext& prototype, const char * hashPath = NULL) {
+        for(std::unique_ptr<AnalysisWorker>& worker : workers) {
+            worker->search.tablebases = prototype.tablebases;
+            worker->search.setNetwork(prototype.network);
+            if(worker->search.transpositionTable.size() != prototype.transpositionTable.size()) worker->search.transpositionTable.resize(prototype.transpositionTable.size());
+        }
+        return !hashPath || workers.front()->search.transpositionTable.open(hashPath);
+    }
+
+    // answer requests from stdin on stdout until the end of the input
+    void serve() {
+        AnalysisWorker& worker = *workers.front();
+        worker.start();
+        std::string line;
+        while(std::getline(std::cin, line)) if(!line.empty()) worker.request(STDOUT_FILENO, line);
+        worker.stop();
+    }
+
+    // listen on the Unix domain socket `path` (replacing any existing file) - returns false if the socket can't be set up
+    bool serve(const char * path) {
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        if(strlen(path) >= sizeof(address.sun_path)) return false;
+        strcpy(address.sun_path, path);
+
+        const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        unlink(path);
+        if(listener < 0 || bind(listener, (sockaddr *) &address, sizeof(address)) || listen(listener, SOMAXCONN)) return false;
+
+        signal(SIGPIPE, SIG_IGN);
+        for(std::unique_ptr<AnalysisWorker>& worker : workers) worker->start();
+
+        // every client is served by the worker with the fewest clients; incomplete lines are buffered until they end (or
+        // grow beyond MAX_REQUEST_SIZE, which drops the client)
+        std::vector<pollfd> fds = {{listener, POLLIN, 0}};
+        std::vector<std::string> buffers(1);
+        std::vector<AnalysisWorker *> assigned(1);
+        char data[4096];
+        while(true) {
+            if(poll(fds.data(), fds.size(), -1) < 0) {
+                if(errno == EINTR) continue; // (interrupted by a signal)
+                break;
+            }
+
+            for(size_t i = fds.size(); i-- > 1; ) {
+                if(!fds[i].revents) continue;
+
+                const ssize_t n = read(fds[i].fd, data, sizeof(data));
+                if(n < 0 && errno == EINTR) continue;
+                if(n > 0) {
+                    buffers[i].append(data, n);
+                    for(size_t end; (end = buffers[i].find('\n')) != std::string::npos; buffers[i].erase(0, end + 1))
+                        if(end) assigned[i]->request(fds[i].fd, buffers[i].substr(0, end));
+                    if(buffers[i].size() <= MAX_REQUEST_SIZE) continue;
+                }
+
+                assigned[i]->disconnect(fds[i].fd);
+                assigned[i]->clients--;
+                fds.erase(fds.begin() + i);
+                buffers.erase(buffers.begin() + i);
+                assigned.erase(assigned.begin() + i);
+            }
+
+            if(fds[0].revents & POLLIN) {
+                const int client = accept(listener, NULL, NULL);
+                if(client < 0) continue;
+                AnalysisWorker * worker = workers.front().get();
+                for(std::unique_ptr<AnalysisWorker>& candidate : workers) if(candidate->clients < worker->clients) worker = candidate.get();
+                worker->clients++;
+                fds.push_back({client, POLLIN, 0});
+                buffers.emplace_back();
+                assigned.push_back(worker);
+            }
+        }
+
+        return false;
+    }
+};
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// search instrumentation can be compiled out entirely by defining NSTATS (e.g. `make DEFINES=-DNSTATS`)
+#ifdef NSTATS
+#define STAT(...)
+#else
+#define STAT(...) __VA_ARGS__
+#endif
+
+// statistics for a single completed search iteration
+struct DepthStats {
+    unsigned int depth; // depth searched
+    uint64_t nodes; // nodes searched during this iteration
+    double seconds; // time spent on this iteration
+};
+
+// counters collected over the course of a search
+struct SearchStats {
+    uint64_t nodes = 0; // positions visited by evaluatePosition()
+    uint64_t qnodes = 0; // positions visited at or beyond the search horizon (by the quiescence search)
+    uint64_t ttProbes = 0; // transposition table lookups
+    uint64_t ttHits = 0; // lookups that found the position
+    uint64_t ttCutoffs = 0; // lookups whose stored result was deep enough to be returned directly
+    uint64_t tbHits = 0; // positions resolved by the endgame tablebases
+    uint64_t betaCutoffs = 0; // nodes where a move failed high
+    uint64_t firstMoveCutoffs = 0; // fail highs caused by the first move searched (measures move ordering quality)
+    uint64_t seePrunes = 0; // moves skipped because they lose material by static exchange evaluation
+    std::vector<DepthStats> iterations; // per-iteration breakdown
+    std::chrono::steady_clock::time_point lap; // start of the current iteration
+    uint64_t lapNodes = 0; // node count at the start of the current iteration
+
+    // clear all counters and restart the clock
+    void reset() {
+        *this = SearchStats();
+        STAT(lap = std::chrono::steady_clock::now());
+    }
+
+    // record the completion of an iteration to depth `depth`
+    void iteration(unsigned int depth) {
+        STAT(
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            iterations.push_back({depth, nodes - lapNodes, std::chrono::duration<double>(now - lap).count()});
+            lap = now;
+            lapNodes = nodes;
+        )
+    }
+
+    // total time elapsed over all recorded iterations
+    double seconds() const {
+        double seconds = 0;
+        for(const DepthStats& iteration : iterations) seconds += iteration.seconds;
+        return seconds;
+    }
+
+    // nodes per second over all recorded iterations
+    double nps() const {
+        double seconds = this->seconds();
+        return seconds > 0 ? nodes / seconds : 0;
+    }
+
+    // effective branching factor (the n-th root of the node count of an n-ply search)
+    double branchingFactor() const {
+        if(iterations.empty() || !iterations.back().depth || !nodes) return 0;
+        return std::pow((double) nodes, 1.0 / iterations.back().depth);
+    }
+
+    // percentage of fail highs that occurred on the first move searched
+    double ordering() const {
+        return betaCutoffs ? 100.0 * firstMoveCutoffs / betaCutoffs : 0;
+    }
+
+    // human-readable summary
+    std::string text() const {
+        std::stringstream stream;
+
+#ifdef NSTATS
+        stream << "Search statistics are disabled in this build\n";
+#else
+        stream << std::fixed << std::setprecision(2);
+        stream << "Nodes: " << nodes << " (quiescence: " << qnodes << ")\n";
+        stream << "TT: " << ttProbes << " probes, " << ttHits << " hits, " << ttCutoffs << " cutoffs\n";
+        if(tbHits) stream << "Tablebase hits: " << tbHits << "\n";
+        stream << "Beta cutoffs: " << betaCutoffs << " (" << ordering() << "% on first move)\n";
+        stream << "SEE prunes: " << seePrunes << "\n";
+        stream << "Branching factor: " << branchingFactor() << "\n";
+        for(const DepthStats& iteration : iterations)
+            stream << "Depth " << iteration.depth << ": " << iteration.nodes << " nodes in " << iteration.seconds << "s ("
+                   << (uint64_t) (iteration.seconds > 0 ? iteration.nodes / iteration.seconds : 0) << " nps)\n";
+        stream << "Total: " << seconds() << "s (" << (uint64_t) nps() << " nps)\n";
+#endif
+
+        return stream.str();
+    }
+
+    // machine-readable summary
+    std::string json() const {
+        std::stringstream stream;
+
+        stream << std::fixed << std::setprecision(6);
+        stream << "{\"nodes\":" << nodes << ",\"qnodes\":" << qnodes;
+        stream << ",\"tt\":{\"probes\":" << ttProbes << ",\"hits\":" << ttHits << ",\"cutoffs\":" << ttCutoffs << "}";
+        stream << ",\"tbHits\":" << tbHits;
+        stream << ",\"betaCutoffs\":" << betaCutoffs << ",\"firstMoveCutoffs\":" << firstMoveCutoffs << ",\"seePrunes\":" << seePrunes;
+        stream << ",\"branchingFactor\":" << branchingFactor() << ",\"seconds\":" << seconds() << ",\"nps\":" << (uint64_t) nps();
+        stream << ",\"iterations\":[";
+        for(size_t i = 0; i < iterations.size(); i++) {
+            const DepthStats& iteration = iterations[i];
+            if(i) stream << ",";
+            stream << "{\"depth\":" << iteration.depth << ",\"nodes\":" << iteration.nodes << ",\"seconds\":" << iteration.seconds
+                   << ",\"nps\":" << (uint64_t) (iteration.seconds > 0 ? iteration.nodes / iteration.seconds : 0) << "}";
+        }
+        stream << "]}";
+
+        return stream.str();
+    }
+};
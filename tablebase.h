@@ -0,0 +1,353 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+// maximum number of pieces (including both kings) covered by the endgame tablebases
+#define TB_PIECES 4
+
+// tablebase file header
+#define TB_MAGIC 0x42544843u // "CHTB"
+#define TB_VERSION 1
+#define TB_HEADER_SIZE 16
+
+// bound on material keys (see Material::key()): one base-6 digit per non-king piece and per color, so 6 ^ TB_PIECES
+constexpr uint32_t TB_MATERIAL_KEYS = [] {
+    uint32_t keys = 1;
+    for(int i = 0; i < TB_PIECES; i++) keys *= 6;
+    return keys;
+}();
+
+/* Tablebase entries are one byte, from the perspective of the side to play:
+    0 = draw (or illegal position)
+    1 - 127 = win, mate in n plies
+    128 - 255 = loss, mated in (n - 128) plies
+*/
+#define TB_DRAW 0
+#define TB_WIN(plies) ((uint8_t) (plies))
+#define TB_LOSS(plies) ((uint8_t) (128 + (plies)))
+#define TB_IS_WIN(value) ((value) && (value) < 128)
+#define TB_IS_LOSS(value) ((value) >= 128)
+#define TB_PLIES(value) ((value) & 127)
+#define TB_MAX_PLIES 127
+
+// tablebase squares are numbered 0-63 (a1, b1, ..., h8)
+#define TB_SQUARE(file, rank) ((uint8_t) (8 * ((rank) - 1) + ((file) - 1)))
+#define TB_FILE(square) ((square) & 7)
+#define TB_RANK(square) ((square) >> 3)
+
+// a piece as seen by the tablebases
+struct TbPiece {
+    PieceColor color;
+    PieceType type;
+    uint8_t square;
+};
+
+// material configuration of a table (non-king pieces of each color, strongest first)
+struct Material {
+    std::vector<PieceType> pieces[2];
+
+    // number of pieces including kings
+    int count() const { return 2 + pieces[WHITE].size() + pieces[BLACK].size(); }
+
+    bool hasPawns() const {
+        for(PieceColor color : {WHITE, BLACK})
+            for(PieceType type : pieces[color]) if(type == PAWN) return true;
+        return false;
+    }
+
+    // whether black is stronger than white (tables are only stored with the stronger side as white)
+    bool flipped() const { return flipped(pieces[WHITE].data(), pieces[WHITE].size(), pieces[BLACK].data(), pieces[BLACK].size()); }
+
+    // flipped() for the pieces of each color given as arrays (strongest first)
+    static bool flipped(const PieceType * white, size_t whites, const PieceType * black, size_t blacks) {
+        if(whites != blacks) return whites < blacks;
+        return std::lexicographical_compare(white, white + whites, black, black + blacks);
+    }
+
+    // the same material with colors exchanged
+    Material flip() const {
+        Material material;
+        material.pieces[WHITE] = pieces[BLACK];
+        material.pieces[BLACK] = pieces[WHITE];
+        return material;
+    }
+
+    // unique numeric key (each piece is a base-6 digit, colors are separated by a zero digit)
+    uint32_t key() const { return key(pieces[WHITE].data(), pieces[WHITE].size(), pieces[BLACK].data(), pieces[BLACK].size()); }
+
+    // key() for the pieces of each color given as arrays (strongest first)
+    static uint32_t key(const PieceType * white, size_t whites, const PieceType * black, size_t blacks) {
+        uint32_t key = 0;
+        for(size_t i = 0; i < whites; i++) key = key * 6 + white[i] + 1;
+        key *= 6;
+        for(size_t i = 0; i < blacks; i++) key = key * 6 + black[i] + 1;
+        return key * 6;
+    }
+
+    // table name (e.g. "KQvKR")
+    std::string name() const {
+        std::string name;
+        for(PieceColor color : {WHITE, BLACK}) {
+            if(color) name += "v";
+            name += "K";
+            for(PieceType type : pieces[color]) name += "PNBRQ"[type];
+        }
+        return name;
+    }
+
+    // sort pieces strongest first
+    void normalize() {
+        for(PieceColor color : {WHITE, BLACK}) std::sort(pieces[color].rbegin(), pieces[color].rend());
+    }
+
+    // every material configuration (stored orientation) with between 3 and `n` pieces
+    static std::vector<Material> all(int n = TB_PIECES) {
+        std::vector<Material> materials;
+        std::vector<std::vector<PieceType>> sides = {{}};
+
+        // all multisets of up to n - 2 pieces
+        for(int size = 1; size <= n - 2; size++) {
+            std::vector<std::vector<PieceType>> next;
+            for(const std::vector<PieceType>& side : sides) {
+                if((int) side.size() != size - 1) continue;
+                for(int type = side.empty() ? QUEEN : side.back(); type >= PAWN; type--) {
+                    std::vector<PieceType> pieces = side;
+                    pieces.push_back((PieceType) type);
+                    next.push_back(pieces);
+                }
+            }
+            sides.insert(sides.end(), next.begin(), next.end());
+        }
+
+        for(const std::vector<PieceType>& white : sides) {
+            for(const std::vector<PieceType>& black : sides) {
+                Material material;
+                material.pieces[WHITE] = white;
+                material.pieces[BLACK] = black;
+                if(material.count() >= 3 && material.count() <= n && !material.flipped()) materials.push_back(material);
+            }
+        }
+
+        // fewer pieces first, then fewer pawns (the order in which tables depend on each other)
+        std::stable_sort(materials.begin(), materials.end(), [](const Material& m1, const Material& m2) {
+            if(m1.count() != m2.count()) return m1.count() < m2.count();
+            return std::count(m1.pieces[0].begin(), m1.pieces[0].end(), PAWN) + std::count(m1.pieces[1].begin(), m1.pieces[1].end(), PAWN)
+                 < std::count(m2.pieces[0].begin(), m2.pieces[0].end(), PAWN) + std::count(m2.pieces[1].begin(), m2.pieces[1].end(), PAWN);
+        });
+
+        return materials;
+    }
+};
+
+// a position in table order: white king, white pieces, black king, black pieces
+struct TbPosition {
+    uint8_t squares[TB_PIECES] = {0};
+    PieceColor toPlay;
+};
+
+// maps positions of a given material to table indices. Pawnless tables use the 8-fold symmetry of the board (the white
+// king is kept in the a1-d1-d4 triangle) and tables with pawns use left-right symmetry (the white king is kept on files a-d)
+class TableIndex {
+private:
+    int8_t triangle[64]; // square -> triangle index (-1 if outside of the triangle)
+    uint8_t triangleSquares[10]; // triangle index -> square
+
+public:
+    Material material;
+    int n; // number of pieces
+    PieceColor colors[TB_PIECES]; // color of the piece in each slot
+    PieceType types[TB_PIECES]; // type of the piece in each slot
+    bool pawns; // whether the table contains pawns
+    size_t size; // number of entries
+
+    TableIndex(const Material& material) : material(material) {
+        n = 0;
+        for(PieceColor color : {WHITE, BLACK}) {
+            colors[n] = color;
+            types[n++] = KING;
+            for(PieceType type : material.pieces[color]) {
+                colors[n] = color;
+                types[n++] = type;
+            }
+        }
+        pawns = material.hasPawns();
+
+        int i = 0;
+        for(uint8_t square = 0; square < 64; square++) {
+            bool inside = TB_FILE(square) < 4 && TB_RANK(square) <= TB_FILE(square);
+            triangle[square] = inside ? i : -1;
+            if(inside) triangleSquares[i++] = square;
+        }
+
+        size = (pawns ? 32 : 10) * 2;
+        for(int slot = 1; slot < n; slot++) size *= (types[slot] == PAWN) ? 48 : 64;
+    }
+
+    // transform a position so that the white king lies in the canonical region of the board
+    void canonicalize(TbPosition& position) const {
+        uint8_t * squares = position.squares;
+        if(TB_FILE(squares[0]) > 3) for(uint8_t& square : position.squares) square ^= 7;
+        if(pawns) return;
+        if(TB_RANK(squares[0]) > 3) for(uint8_t& square : position.squares) square ^= 56;
+
+        // reflect in the a1-h8 diagonal so that the king lies below it (or, if the king is on the diagonal, so that the
+        // first piece off the diagonal lies below it - this keeps every position's canonical form unique)
+        bool transpose = TB_RANK(squares[0]) > TB_FILE(squares[0]);
+        for(int slot = 1; slot < n && TB_RANK(squares[0]) == TB_FILE(squares[0]); slot++) {
+            if(TB_RANK(squares[slot]) == TB_FILE(squares[slot])) continue;
+            transpose = TB_RANK(squares[slot]) > TB_FILE(squares[slot]);
+            break;
+        }
+        if(transpose) for(uint8_t& square : position.squares) square = (TB_FILE(square) << 3) | TB_RANK(square);
+    }
+
+    // table index of a position (the position is canonicalized in place)
+    size_t index(TbPosition& position) const {
+        canonicalize(position);
+
+        size_t index = pawns ? (4 * TB_RANK(position.squares[0]) + TB_FILE(position.squares[0])) : triangle[position.squares[0]];
+        for(int slot = 1; slot < n; slot++) {
+            if(types[slot] == PAWN) index = index * 48 + position.squares[slot] - 8;
+            else index = index * 64 + position.squares[slot];
+        }
+        return 2 * index + position.toPlay;
+    }
+
+    // position stored at table index `index`
+    TbPosition position(size_t index) const {
+        TbPosition position;
+        position.toPlay = (PieceColor) (index & 1);
+        index >>= 1;
+        for(int slot = n - 1; slot >= 1; slot--) {
+            if(types[slot] == PAWN) {
+                position.squares[slot] = index % 48 + 8;
+                index /= 48;
+            } else {
+                position.squares[slot] = index % 64;
+                index /= 64;
+            }
+        }
+        position.squares[0] = pawns ? (8 * (index / 4) + index % 4) : triangleSquares[index];
+        return position;
+    }
+};
+
+// memory-mapped endgame tablebases (generated offline by tbgen)
+class Tablebases {
+private:
+    struct Table {
+        TableIndex index;
+        const uint8_t * data; // mapped file (including header)
+        size_t length; // size of the mapping in bytes
+    };
+
+    std::unique_ptr<Table> tables[TB_MATERIAL_KEYS]; // tables by material key (null if not loaded)
+    size_t count = 0; // number of loaded tables
+
+public:
+    Tablebases() {}
+    Tablebases(const Tablebases&) = delete;
+    Tablebases& operator=(const Tablebases&) = delete;
+
+    ~Tablebases() {
+        for(std::unique_ptr<Table>& table : tables) if(table) munmap((void *) table->data, table->length);
+    }
+
+    // number of loaded tables
+    size_t size() const { return count; }
+
+    // map a single table file - returns true upon success
+    bool add(const Material& material, const std::string& path) {
+        if(material.count() > TB_PIECES) return false;
+        int fd = open(path.c_str(), O_RDONLY);
+        if(fd < 0) return false;
+
+        TableIndex index(material);
+        struct stat st;
+        if(fstat(fd, &st) || (size_t) st.st_size != TB_HEADER_SIZE + index.size) {
+            close(fd);
+            return false;
+        }
+
+        void * mapping = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if(mapping == MAP_FAILED) return false;
+
+        // reject files with an unknown layout
+        uint32_t header[2];
+        memcpy(header, mapping, sizeof(header));
+        if(header[0] != TB_MAGIC || header[1] != TB_VERSION) {
+            munmap(mapping, st.st_size);
+            return false;
+        }
+
+        madvise(mapping, st.st_size, MADV_RANDOM);
+        std::unique_ptr<Table>& table = tables[material.key()];
+        if(table) munmap((void *) table->data, table->length);
+        else count++;
+        table = std::make_unique<Table>(Table{index, (const uint8_t *) mapping, (size_t) st.st_size});
+        return true;
+    }
+
+    // map every table found in `directory` - returns the number of tables loaded
+    size_t load(const std::string& directory, int n = TB_PIECES) {
+        for(const Material& material : Material::all(n)) add(material, directory + "/" + material.name() + ".tb");
+        return count;
+    }
+
+    // look up a position given as a list of pieces - returns false if no table covers it
+    bool probe(const TbPiece * pieces, int n, PieceColor toPlay, uint8_t& value) const {
+        if(n > TB_PIECES) return false;
+
+        // bare kings
+        if(n == 2) {
+            value = TB_DRAW;
+            return true;
+        }
+
+        // the material (non-king pieces of each color, strongest first as normalize() sorts them), without allocating
+        PieceType types[2][TB_PIECES];
+        size_t counts[2] = {0, 0};
+        for(int i = 0; i < n; i++) {
+            if(pieces[i].type == KING) continue;
+            PieceType * side = types[pieces[i].color];
+            size_t j = counts[pieces[i].color]++;
+            for(; j > 0 && side[j - 1] < pieces[i].type; j--) side[j] = side[j - 1];
+            side[j] = pieces[i].type;
+        }
+
+        // tables are stored with the stronger side as white, so mirror the position vertically and swap colors if necessary
+        const bool flip = Material::flipped(types[WHITE], counts[WHITE], types[BLACK], counts[BLACK]);
+        const PieceColor strong = flip ? BLACK : WHITE;
+        const Table * found = tables[Material::key(types[strong], counts[strong], types[!strong], counts[!strong])].get();
+        if(!found) return false;
+        const Table& table = *found;
+
+        // place pieces into table slots
+        TbPosition position;
+        position.toPlay = flip ? !toPlay : toPlay;
+        bool used[TB_PIECES] = {false};
+        for(int slot = 0; slot < n; slot++) {
+            for(int i = 0; i < n; i++) {
+                if(used[i] || pieces[i].type != table.index.types[slot] || (flip ? !pieces[i].color : pieces[i].color) != table.index.colors[slot]) continue;
+                position.squares[slot] = flip ? (pieces[i].square ^ 56) : pieces[i].square;
+                used[i] = true;
+                break;
+            }
+        }
+
+        value = table.data[TB_HEADER_SIZE + table.index.index(position)];
+        return true;
+    }
+};
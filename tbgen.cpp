@@ -0,0 +1,551 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+#include <getopt.h>
+#include <sys/stat.h>
+
+#include "tablebase.h"
+
+/* Endgame tablebase generator: computes win/draw/loss and distance-to-mate tables by retrograde analysis.
+
+    1. Every position is visited once (in parallel): illegal positions are discarded, checkmates are seeded as losses
+       and the moves leaving the table (captures and promotions) are resolved by probing the smaller tables.
+    2. Positions are then resolved in order of increasing distance to mate. When a position is found to be lost, every
+       position that can reach it with a quiet move is won; when a position is found to be won, each predecessor loses
+       one of its remaining non-losing moves and is lost once none are left.
+    3. Everything left unresolved is a draw.
+*/
+
+// generation state flags
+#define FLAG_INVALID 1 // impossible or non-canonical position (overlapping pieces or the side not to play is in check)
+#define FLAG_STALEMATE 2 // side to play has no legal moves and is not in check
+
+// number of distinct distances tracked during generation
+#define LEVELS 256
+
+// king and knight move offsets as (file, rank) pairs
+const int KING_STEPS[8][2] = {{-1, -1}, {-1, 0}, {-1, 1}, {0, -1}, {0, 1}, {1, -1}, {1, 0}, {1, 1}};
+const int KNIGHT_STEPS[8][2] = {{1, 2}, {1, -2}, {2, 1}, {2, -1}, {-1, 2}, {-1, -2}, {-2, 1}, {-2, -1}};
+const int ROOK_STEPS[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+const int BISHOP_STEPS[4][2] = {{1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+
+// a single move in the generator's representation
+struct TbMove {
+    int slot; // moving piece
+    uint8_t to; // target square
+    int capture; // slot of the captured piece (-1 if none)
+    PieceType promoteTo; // promotion type (PAWN if none)
+};
+
+// a position under construction: piece squares by slot and a mailbox of slots
+struct TbBoard {
+    const TableIndex * index;
+    uint8_t squares[TB_PIECES] = {0};
+    bool alive[TB_PIECES];
+    PieceType types[TB_PIECES];
+    int8_t mailbox[64];
+    PieceColor toPlay;
+
+    TbBoard(const TableIndex& index, const TbPosition& position) : index(&index) {
+        memset(mailbox, -1, sizeof(mailbox));
+        toPlay = position.toPlay;
+        for(int slot = 0; slot < index.n; slot++) {
+            squares[slot] = position.squares[slot];
+            alive[slot] = true;
+            types[slot] = index.types[slot];
+        }
+    }
+
+    // whether no two pieces share a square (fills the mailbox)
+    bool place() {
+        for(int slot = 0; slot < index->n; slot++) {
+            if(mailbox[squares[slot]] >= 0) return false;
+            mailbox[squares[slot]] = slot;
+        }
+        return true;
+    }
+
+    static bool step(uint8_t square, const int offset[2], uint8_t& target) {
+        int file = TB_FILE(square) + offset[0], rank = TB_RANK(square) + offset[1];
+        if(file < 0 || file > 7 || rank < 0 || rank > 7) return false;
+        target = 8 * rank + file;
+        return true;
+    }
+
+    // whether the piece in `slot` attacks `target`
+    bool attacks(int slot, uint8_t target) const {
+        const uint8_t from = squares[slot];
+        const int dfile = TB_FILE(target) - TB_FILE(from), drank = TB_RANK(target) - TB_RANK(from);
+
+        switch(types[slot]) {
+        case PAWN:
+            return abs(dfile) == 1 && drank == (index->colors[slot] ? -1 : 1);
+        case KNIGHT:
+            return abs(dfile * drank) == 2;
+        case KING:
+            return from != target && abs(dfile) <= 1 && abs(drank) <= 1;
+        case BISHOP:
+            if(abs(dfile) != abs(drank) || !dfile) return false;
+            break;
+        case ROOK:
+            if(dfile && drank) return false;
+            if(!dfile && !drank) return false;
+            break;
+        case QUEEN:
+            if((dfile && drank && abs(dfile) != abs(drank)) || (!dfile && !drank)) return false;
+            break;
+        }
+
+        // ensure the path is clear
+        const int df = (dfile > 0) - (dfile < 0), dr = (drank > 0) - (drank < 0);
+        for(int square = from + 8 * dr + df; square != target; square += 8 * dr + df) if(mailbox[square] >= 0) return false;
+        return true;
+    }
+
+    // whether `square` is attacked by a piece of color `color`
+    bool attacked(PieceColor color, uint8_t square) const {
+        for(int slot = 0; slot < index->n; slot++)
+            if(alive[slot] && index->colors[slot] == color && attacks(slot, square)) return true;
+        return false;
+    }
+
+    int king(PieceColor color) const {
+        return color ? 1 + index->material.pieces[WHITE].size() : 0;
+    }
+
+    bool inCheck(PieceColor color) const {
+        return attacked(!color, squares[king(color)]);
+    }
+
+    // pseudolegal moves for the side to play
+    int moves(TbMove * moves) const {
+        int n = 0;
+
+        auto add = [&](int slot, uint8_t to) {
+            int capture = mailbox[to];
+            if(capture >= 0 && (index->colors[capture] == toPlay || types[capture] == KING)) return false;
+            moves[n++] = {slot, to, capture, PAWN};
+            return capture < 0;
+        };
+
+        for(int slot = 0; slot < index->n; slot++) {
+            if(!alive[slot] || index->colors[slot] != toPlay) continue;
+            const uint8_t from = squares[slot];
+            uint8_t to;
+
+            switch(types[slot]) {
+            case PAWN: {
+                const int dr = toPlay ? -1 : 1;
+                const bool promotion = TB_RANK(from) + dr == (toPlay ? 0 : 7);
+                const int first = n;
+
+                // pushes
+                to = from + 8 * dr;
+                if(mailbox[to] < 0) {
+                    moves[n++] = {slot, to, -1, PAWN};
+                    if(TB_RANK(from) == (toPlay ? 6 : 1) && mailbox[to + 8 * dr] < 0) moves[n++] = {slot, (uint8_t) (to + 8 * dr), -1, PAWN};
+                }
+
+                // captures
+                for(int df : {-1, 1}) {
+                    int file = TB_FILE(from) + df;
+                    if(file < 0 || file > 7) continue;
+                    to = from + 8 * dr + df;
+                    int capture = mailbox[to];
+                    if(capture >= 0 && index->colors[capture] != toPlay && types[capture] != KING) moves[n++] = {slot, to, capture, PAWN};
+                }
+
+                // expand promotions
+                if(promotion) {
+                    const int last = n;
+                    for(int i = first; i < last; i++) {
+                        moves[i].promoteTo = QUEEN;
+                        for(PieceType type : {ROOK, BISHOP, KNIGHT}) {
+                            moves[n] = moves[i];
+                            moves[n++].promoteTo = type;
+                        }
+                    }
+                }
+                break;
+            }
+            case KNIGHT:
+                for(const int * offset : KNIGHT_STEPS) if(step(from, offset, to)) add(slot, to);
+                break;
+            case KING:
+                for(const int * offset : KING_STEPS) if(step(from, offset, to)) add(slot, to);
+                break;
+            default:
+                for(int i = 0; i < 8; i++) {
+                    if(types[slot] == ROOK && i >= 4) break;
+                    if(types[slot] == BISHOP && i < 4) continue;
+                    const int * offset = (i < 4) ? ROOK_STEPS[i] : BISHOP_STEPS[i - 4];
+                    uint8_t square = from;
+                    while(step(square, offset, to) && add(slot, to)) square = to;
+                }
+            }
+        }
+
+        return n;
+    }
+
+    void make(const TbMove& move) {
+        mailbox[squares[move.slot]] = -1;
+        if(move.capture >= 0) alive[move.capture] = false;
+        squares[move.slot] = move.to;
+        mailbox[move.to] = move.slot;
+        if(move.promoteTo != PAWN) types[move.slot] = move.promoteTo;
+        toPlay = !toPlay;
+    }
+
+    void unmake(const TbMove& move, uint8_t from) {
+        toPlay = !toPlay;
+        types[move.slot] = index->types[move.slot];
+        squares[move.slot] = from;
+        mailbox[from] = move.slot;
+        mailbox[move.to] = -1;
+        if(move.capture >= 0) {
+            alive[move.capture] = true;
+            mailbox[move.to] = move.capture;
+        }
+    }
+
+    TbPosition position() const {
+        TbPosition position;
+        memcpy(position.squares, squares, sizeof(squares));
+        position.toPlay = toPlay;
+        return position;
+    }
+
+    // list of the remaining pieces (used to probe other tables)
+    int pieces(TbPiece * pieces) const {
+        int n = 0;
+        for(int slot = 0; slot < index->n; slot++)
+            if(alive[slot]) pieces[n++] = {index->colors[slot], types[slot], squares[slot]};
+        return n;
+    }
+};
+
+class Generator {
+private:
+    const TableIndex index;
+    const Tablebases& tablebases; // previously generated tables
+    unsigned int threads;
+
+    std::vector<uint8_t> values; // resolved values
+    std::vector<uint8_t> counts; // number of moves not yet known to lose
+    std::vector<uint8_t> longest; // longest known mate against the side to play through a capture or promotion
+    std::vector<uint8_t> flags;
+    std::vector<std::vector<uint32_t>> levels; // positions to resolve, by distance to mate
+
+    // run `work(thread, begin, end)` over the range [0, size) in parallel
+    template <typename Work>
+    void parallel(size_t size, Work work) {
+        std::vector<std::thread> pool;
+        const size_t chunk = (size + threads - 1) / threads;
+        for(unsigned int t = 0; t < threads; t++) {
+            size_t begin = std::min(size, t * chunk), end = std::min(size, begin + chunk);
+            pool.emplace_back(work, t, begin, end);
+        }
+        for(std::thread& thread : pool) thread.join();
+    }
+
+    // merge per-thread level lists into the shared ones
+    void merge(std::vector<std::vector<std::vector<uint32_t>>>& local) {
+        for(std::vector<std::vector<uint32_t>>& lists : local)
+            for(int level = 0; level < LEVELS; level++)
+                levels[level].insert(levels[level].end(), lists[level].begin(), lists[level].end());
+    }
+
+    // examine every position once
+    void initialize(size_t begin, size_t end, std::vector<std::vector<uint32_t>>& local) {
+        TbMove moves[128];
+        uint32_t children[128];
+        TbPiece pieces[TB_PIECES];
+
+        for(size_t i = begin; i < end; i++) {
+            // skip duplicate encodings of symmetric positions (never probed) as well as illegal positions
+            TbPosition position = index.position(i);
+            if(index.index(position) != i) {
+                flags[i] = FLAG_INVALID;
+                continue;
+            }
+
+            TbBoard board(index, position);
+            if(!board.place() || board.inCheck(!board.toPlay)) {
+                flags[i] = FLAG_INVALID;
+                continue;
+            }
+
+            int legal = 0, internal = 0, count = 0, win = LEVELS, loss = 0;
+            int n = board.moves(moves);
+            for(int m = 0; m < n; m++) {
+                const TbMove& move = moves[m];
+                const uint8_t from = board.squares[move.slot];
+                board.make(move);
+
+                if(!board.inCheck(!board.toPlay)) {
+                    legal++;
+
+                    if(move.capture < 0 && move.promoteTo == PAWN) {
+                        TbPosition position = board.position();
+                        children[internal++] = index.index(position);
+                    } else {
+                        // the move leaves this table
+                        uint8_t value;
+                        int size = board.pieces(pieces);
+                        if(!tablebases.probe(pieces, size, board.toPlay, value)) {
+                            std::cerr << "missing table for a successor of " << index.material.name() << "\n";
+                            exit(EXIT_FAILURE);
+                        }
+
+                        if(TB_IS_WIN(value)) loss = std::max(loss, (int) TB_PLIES(value));
+                        else {
+                            count++;
+                            if(TB_IS_LOSS(value)) win = std::min(win, TB_PLIES(value) + 1);
+                        }
+                    }
+                }
+
+                board.unmake(move, from);
+            }
+
+            if(!legal) {
+                if(board.inCheck(board.toPlay)) local[0].push_back(i);
+                else flags[i] = FLAG_STALEMATE;
+                continue;
+            }
+
+            // count distinct successors within the table (symmetric positions can be reached by more than one move)
+            std::sort(children, children + internal);
+            count += std::unique(children, children + internal) - children;
+
+            counts[i] = count;
+            longest[i] = loss;
+            if(win < LEVELS) local[win].push_back(i);
+            if(!count) local[std::min(loss + 1, LEVELS - 1)].push_back(i);
+        }
+    }
+
+    // distinct positions from which the side not to play in `i` could have reached it with a quiet move
+    int predecessors(size_t i, uint32_t * result) const {
+        TbBoard board(index, index.position(i));
+        board.place();
+        const PieceColor mover = !board.toPlay;
+        int n = 0;
+
+        auto add = [&](int slot, uint8_t from) {
+            if(board.mailbox[from] >= 0) return false;
+            TbPosition position = board.position();
+            position.squares[slot] = from;
+            position.toPlay = mover;
+            size_t j = index.index(position);
+            if(!(flags[j] & FLAG_INVALID)) result[n++] = j;
+            return true;
+        };
+
+        for(int slot = 0; slot < index.n; slot++) {
+            if(index.colors[slot] != mover) continue;
+            const uint8_t square = board.squares[slot];
+            uint8_t from;
+
+            switch(index.types[slot]) {
+            case PAWN: {
+                const int dr = mover ? 1 : -1;
+                const int rank = TB_RANK(square) + dr;
+                if(rank < 1 || rank > 6 || !add(slot, square + 8 * dr)) break;
+                if(TB_RANK(square) == (mover ? 4 : 3)) add(slot, square + 16 * dr);
+                break;
+            }
+            case KNIGHT:
+                for(const int * offset : KNIGHT_STEPS) if(TbBoard::step(square, offset, from)) add(slot, from);
+                break;
+            case KING:
+                for(const int * offset : KING_STEPS) if(TbBoard::step(square, offset, from)) add(slot, from);
+                break;
+            default:
+                for(int d = 0; d < 8; d++) {
+                    if(index.types[slot] == ROOK && d >= 4) break;
+                    if(index.types[slot] == BISHOP && d < 4) continue;
+                    const int * offset = (d < 4) ? ROOK_STEPS[d] : BISHOP_STEPS[d - 4];
+                    uint8_t origin = square;
+                    while(TbBoard::step(origin, offset, from) && add(slot, from)) origin = from;
+                }
+            }
+        }
+
+        std::sort(result, result + n);
+        return std::unique(result, result + n) - result;
+    }
+
+    // resolve every position queued at distance `level`
+    void resolve(int level, size_t begin, size_t end, std::vector<std::vector<uint32_t>>& local) {
+        const int plies = std::min(level, TB_MAX_PLIES);
+        uint32_t previous[256];
+
+        for(size_t k = begin; k < end; k++) {
+            const uint32_t i = levels[level][k];
+            std::atomic_ref<uint8_t> value(values[i]);
+
+            // positions with no moves left that don't lose are lost, all other queued positions are won
+            const bool lost = !std::atomic_ref<uint8_t>(counts[i]).load(std::memory_order_relaxed);
+            uint8_t expected = TB_DRAW;
+            if(!value.compare_exchange_strong(expected, lost ? TB_LOSS(plies) : TB_WIN(plies))) continue;
+
+            int n = predecessors(i, previous);
+            for(int p = 0; p < n; p++) {
+                const uint32_t j = previous[p];
+                if(std::atomic_ref<uint8_t>(values[j]).load(std::memory_order_relaxed) || (flags[j] & FLAG_STALEMATE)) continue;
+
+                if(lost) local[std::min(level + 1, LEVELS - 1)].push_back(j);
+                else if(std::atomic_ref<uint8_t>(counts[j]).fetch_sub(1) == 1)
+                    local[std::min(std::max((int) longest[j], level) + 1, LEVELS - 1)].push_back(j);
+            }
+        }
+    }
+
+public:
+    Generator(const Material& material, const Tablebases& tablebases, unsigned int threads)
+        : index(material), tablebases(tablebases), threads(threads) {}
+
+    void run() {
+        values.assign(index.size, TB_DRAW);
+        counts.assign(index.size, 0);
+        longest.assign(index.size, 0);
+        flags.assign(index.size, 0);
+        levels.assign(LEVELS, {});
+
+        std::vector<std::vector<std::vector<uint32_t>>> local(threads, std::vector<std::vector<uint32_t>>(LEVELS));
+        parallel(index.size, [&](unsigned int t, size_t begin, size_t end) { initialize(begin, end, local[t]); });
+        merge(local);
+
+        for(int level = 0; level < LEVELS; level++) {
+            if(levels[level].empty()) continue;
+
+            for(std::vector<std::vector<uint32_t>>& lists : local) for(std::vector<uint32_t>& list : lists) list.clear();
+            parallel(levels[level].size(), [&](unsigned int t, size_t begin, size_t end) { resolve(level, begin, end, local[t]); });
+            levels[level] = std::vector<uint32_t>();
+            merge(local);
+        }
+    }
+
+    // longest mate in the table (in plies) and the number of won, drawn and lost positions
+    void summary(int& longest, size_t& wins, size_t& draws, size_t& losses) const {
+        longest = 0;
+        wins = draws = losses = 0;
+        for(size_t i = 0; i < index.size; i++) {
+            if(flags[i] & FLAG_INVALID) continue;
+            if(TB_IS_WIN(values[i])) wins++;
+            else if(TB_IS_LOSS(values[i])) losses++;
+            else draws++;
+            if(values[i]) longest = std::max(longest, (int) TB_PLIES(values[i]));
+        }
+    }
+
+    bool write(const std::string& path) const {
+        FILE * fp = fopen(path.c_str(), "wb");
+        if(!fp) return false;
+
+        uint32_t header[TB_HEADER_SIZE / sizeof(uint32_t)] = {TB_MAGIC, TB_VERSION, (uint32_t) index.n, 0};
+        bool ok = fwrite(header, 1, TB_HEADER_SIZE, fp) == TB_HEADER_SIZE && fwrite(values.data(), 1, values.size(), fp) == values.size();
+        return !fclose(fp) && ok;
+    }
+};
+
+// every table that positions of `material` can convert into with a single capture and/or promotion
+std::vector<Material> successors(const Material& material) {
+    std::vector<Material> result;
+
+    for(PieceColor color : {WHITE, BLACK}) {
+        const std::vector<PieceType>& own = material.pieces[color];
+        const std::vector<PieceType>& other = material.pieces[!color];
+
+        for(int capture = -1; capture < (int) other.size(); capture++) {
+            for(int pawn = -1; pawn < (int) own.size(); pawn++) {
+                if(pawn >= 0 && own[pawn] != PAWN) continue;
+                for(PieceType promoteTo : {KNIGHT, BISHOP, ROOK, QUEEN}) {
+                    if(capture < 0 && pawn < 0) break;
+                    Material next = material;
+                    if(capture >= 0) next.pieces[!color].erase(next.pieces[!color].begin() + capture);
+                    if(pawn >= 0) next.pieces[color][pawn] = promoteTo;
+                    next.normalize();
+                    if(next.flipped()) next = next.flip();
+                    if(next.count() > 2) result.push_back(next);
+                    if(pawn < 0) break;
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+// generate the table for `material` (and any missing tables it depends on) into `directory`
+void generate(const Material& material, const std::string& directory, Tablebases& tablebases, unsigned int threads) {
+    const std::string path = directory + "/" + material.name() + ".tb";
+    if(tablebases.add(material, path)) return;
+
+    for(const Material& successor : successors(material)) generate(successor, directory, tablebases, threads);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    Generator generator(material, tablebases, threads);
+    generator.run();
+
+    if(!generator.write(path) || !tablebases.add(material, path)) {
+        std::cerr << "Could not write table '" << path << "'\n";
+        exit(EXIT_FAILURE);
+    }
+
+    int longest;
+    size_t wins, draws, losses;
+    generator.summary(longest, wins, draws, losses);
+    std::cout << material.name() << ": " << wins << " wins, " << draws << " draws, " << losses << " losses, longest mate "
+              << longest << " plies (" << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << "s)" << std::endl;
+}
+
+int main(int argc, char * argv[]) {
+    std::string directory = ".";
+    unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+
+    int opt;
+    while((opt = getopt(argc, argv, "o:j:")) != -1) {
+        switch(opt) {
+            case 'o':
+                directory = optarg;
+                break;
+            case 'j':
+                threads = std::max(1, std::stoi(optarg));
+                break;
+            default:
+                std::cerr << "Usage: tbgen [options] [tables]\n";
+                std::cerr << "-o dir     : output directory (default: current directory)\n";
+                std::cerr << "-j threads : number of worker threads (default: all cores)\n";
+                std::cerr << "tables     : names of the tables to generate, e.g. KQvKR (default: all tables with up to " << TB_PIECES << " pieces)" << std::endl;
+                return EXIT_FAILURE;
+        }
+    }
+
+    mkdir(directory.c_str(), 0755);
+
+    // select tables
+    std::vector<Material> materials = Material::all();
+    if(optind < argc) {
+        std::vector<Material> selected;
+        for(int i = optind; i < argc; i++) {
+            auto it = std::find_if(materials.begin(), materials.end(), [&](const Material& m) { return m.name() == argv[i]; });
+            if(it == materials.end()) {
+                std::cerr << "Unknown table '" << argv[i] << "'\n";
+                return EXIT_FAILURE;
+            }
+            selected.push_back(*it);
+        }
+        materials = selected;
+    }
+
+    Tablebases tablebases;
+    for(const Material& material : materials) generate(material, directory, tablebases, threads);
+
+    return 0;
+}
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include "board.h"
+
+/* Terminal display: the board, the move list and a few status lines (the frame) are drawn at the top of the screen, and
+    everything else written to the terminal (prompts, command output, ...) scrolls in a region below them. Each frame is
+    rendered into one buffer and written with a single system call. Only what changed since the previous frame is drawn:
+    squares whose piece or highlight changed, the moves played since, and the status lines if their text changed. The
+    whole frame is redrawn the first time and when the move list gets shorter (e.g. a new game). */
+
+// Unicode representation of pieces
+const char PIECES[2][7][4] = {
+    {"\u2659", "\u2658", "\u2657", "\u2656", "\u2655", "\u2654"},
+    {"\u265f", "\u265e", "\u265d", "\u265c", "\u265b", "\u265a"}
+};
+
+// foreground (piece) terminal colors
+const char * const FOREGROUND[2] = {"\x1b[38:5:255m", "\x1b[38:5:232m"};
+
+// background terminal colors of the squares: light and dark squares, the last move's starting and ending squares, and
+// (in debug mode) rooks with castling rights and pawns that can be captured en passant
+enum Tile : uint8_t { TILE_LIGHT, TILE_DARK, TILE_FROM, TILE_TO, TILE_CASTLING, TILE_PASSANT };
+const char * const BACKGROUND[6] = {"\x1b[48:5:248m", "\x1b[48:5:240m", "\x1b[46m", "\x1b[106m", "\x1b[41m", "\x1b[44m"};
+
+// initial capacity of the frame buffer (enough for a full frame with a long move list, so it never grows in practice)
+#define TERMINAL_BUFFER_SIZE (64 * 1024)
+
+// width at which the move list is wrapped
+#define MOVE_LIST_WIDTH 80
+
+// number of rows of the board (the file labels, the ranks and a blank line)
+#define BOARD_ROWS 11
+
+class Terminal {
+private:
+    std::string buffer; // the frame being rendered
+    uint16_t cells[8][8]; // the piece and tile of each square as drawn (CELL_NONE: not drawn yet)
+    bool drawn = false; // whether the frame is on the screen
+    int repetitions = 0; // repetition count as drawn (debug mode)
+    size_t shown = 0; // number of moves in the move list as drawn
+    unsigned int moveRow = 0, moveColumn = 0; // where the next move goes (1-based row, 0-based column)
+    unsigned int statusRow = 0; // first row of the status lines
+    std::string status, previousStatus; // status lines being rendered and as drawn
+
+    static const uint16_t CELL_NONE = 0xffff;
+
+    void append(const char * text) { buffer += text; }
+
+    void append(unsigned int n) {
+        char digits[16];
+        buffer.append(digits, snprintf(digits, sizeof(digits), "%u", n));
+    }
+
+    static unsigned int digits(unsigned int n) {
+        unsigned int count = 1;
+        while(n >= 10) {
+            n /= 10;
+            count++;
+        }
+        return count;
+    }
+
+    // move the cursor to `row` and `column` (1-based)
+    void moveTo(unsigned int row, unsigned int column) {
+        append("\x1b[");
+        append(row);
+        append(";");
+        append(column);
+        append("H");
+    }
+
+    // the tile of a square
+    static Tile tile(const Board& board, const std::vector<Move>& moves, Rank rank, File file, bool debug) {
+        const Coord coord = {file, rank};
+        const GameState& state = board.state();
+        Tile tile = (Tile) board.colors[rank][file];
+        if(!moves.empty() && moves.back().from == coord) tile = TILE_FROM;
+        if(!moves.empty() && moves.back().to == coord) tile = TILE_TO;
+        if(debug) {
+            if((rank == 1 || rank == 8) && (file == A || file == H) && state.canCastle[rank == 8][file == H]) tile = TILE_CASTLING;
+            if(state.passant == file && rank == RANK(!board.toPlay, 4)) tile = TILE_PASSANT;
+        }
+        return tile;
+    }
+
+    // undo the scrolling region (when the program exits or is interrupted)
+    static void restore() {
+        const char reset[] = "\x1b" "7" "\x1b[r" "\x1b" "8";
+        if(::write(STDOUT_FILENO, reset, sizeof(reset) - 1) < 0) return;
+    }
+
+    static void interrupted(int signal) {
+        restore();
+        _exit(128 + signal);
+    }
+
+    // write the frame to the terminal
+    void flush() {
+        std::cout.flush();
+        for(size_t written = 0; written < buffer.size();) {
+            const ssize_t n = ::write(STDOUT_FILENO, buffer.data() + written, buffer.size() - written);
+            if(n <= 0) break;
+            written += n;
+        }
+    }
+
+public:
+    Terminal() { buffer.reserve(TERMINAL_BUFFER_SIZE); }
+
+    // draw the position on `board` reached by `moves`, followed by the status lines `text` (each ending with a newline)
+    void draw(const Board& board, const std::vector<Move>& moves, std::string_view text, bool debug = false) {
+        buffer.clear();
+        const bool full = !drawn || moves.size() < shown;
+        if(full) {
+            if(!drawn) {
+                std::atexit(restore);
+                std::signal(SIGINT, interrupted);
+                std::signal(SIGTERM, interrupted);
+            }
+            drawn = true;
+            append("\x1b[r\x1b[H\x1b[J   a  b  c  d  e  f  g  h\n");
+            for(Rank rank = 8; rank >= 1; rank--) {
+                append(rank);
+                append("                          ");
+                append(rank);
+                append("\n");
+            }
+            append("   a  b  c  d  e  f  g  h\n");
+            for(auto& rank : cells)
+                for(uint16_t& cell : rank) cell = CELL_NONE;
+            repetitions = 0;
+            shown = 0;
+            moveRow = BOARD_ROWS + debug + 1;
+            moveColumn = 0;
+            statusRow = 0;
+        } else append("\x1b" "7"); // save the cursor (in the scrolling region)
+
+        // squares that changed
+        for(Rank rank = 1; rank <= 8; rank++) {
+            for(File file = A; file <= H; file++) {
+                const Square square = board.board[rank][file];
+                const Tile background = tile(board, moves, rank, file, debug);
+                const uint16_t cell = square | background << 8;
+                if(cells[rank - 1][file - 1] == cell) continue;
+                cells[rank - 1][file - 1] = cell;
+
+                moveTo(10 - rank, 3 * file);
+                append(BACKGROUND[background]);
+                append(" ");
+                if(square) {
+                    append(FOREGROUND[PIECE_COLOR(square)]);
+                    append(PIECES[PIECE_COLOR(square)][PIECE_TYPE(square)]);
+                } else append(" ");
+                append(" \x1b[0m");
+            }
+        }
+
+        if(debug && board.repetitions() != repetitions) {
+            moveTo(BOARD_ROWS + 1, 1);
+            append("\x1b[2KThis position has occurred ");
+            append(repetitions = board.repetitions());
+            append(" time(s)");
+        }
+
+        // moves played since (numbered like displayMoves(), from 1 whatever the starting position)
+        char description[MOVE_STRING_SIZE];
+        const unsigned int offset = !moves.empty() && moves.front().piece.color == BLACK;
+        if(shown < moves.size()) moveTo(moveRow, moveColumn + 1);
+        for(; shown < moves.size(); shown++) {
+            const Move& move = moves[shown];
+            const char * notation = move.algebraic[0] ? move.algebraic : board.toLongAlgebraic(move, description);
+            const bool numbered = move.piece.color == WHITE || !shown;
+            const unsigned int number = (shown + offset) / 2 + 1;
+            const unsigned int width = (numbered ? digits(number) + (move.piece.color ? 4 : 2) : 0) + strlen(notation) + 1;
+            if(moveColumn && moveColumn + width > MOVE_LIST_WIDTH) {
+                moveTo(++moveRow, 1);
+                append("\x1b[K"); // (the status lines may have been there)
+                moveColumn = 0;
+            }
+            if(numbered) {
+                append(number);
+                append(move.piece.color ? "... " : ". ");
+            }
+            append(notation);
+            append(" ");
+            moveColumn += width;
+        }
+
+        // status lines (the check message and the caller's text)
+        status.clear();
+        if(board.result == GameResult::IN_PROGRESS && (moves.empty() ? board.inCheck(board.toPlay) : moves.back().check)) status += "Check!\n";
+        status += text;
+        if(statusRow != moveRow + 1 || status != previousStatus) {
+            const unsigned int rows = std::count(status.begin(), status.end(), '\n');
+            const bool resized = statusRow != moveRow + 1 || rows != (unsigned int) std::count(previousStatus.begin(), previousStatus.end(), '\n');
+            statusRow = moveRow + 1;
+            moveTo(statusRow, 1);
+            for(char c : status) {
+                if(c == '\n') append("\x1b[K");
+                buffer += c;
+            }
+            previousStatus = status;
+
+            // the scrolling region begins below the frame (setting it homes the cursor, which then goes to the top of
+            // the region, as what was below the frame is cleared)
+            if(resized || full) {
+                append("\x1b[J\x1b[");
+                append(statusRow + rows);
+                append("r");
+                moveTo(statusRow + rows, 1);
+                flush();
+                return;
+            }
+        }
+
+        append("\x1b" "8"); // restore the cursor
+        flush();
+    }
+};
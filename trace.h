@@ -0,0 +1,136 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+#include "board.h"
+
+// search tracing can be compiled out entirely by defining NTRACE (e.g. `make DEFINES=-DNTRACE`)
+#ifdef NTRACE
+#define TRACE(...)
+#else
+#define TRACE(...) __VA_ARGS__
+#endif
+
+/* Search tracing: when a search context has a trace attached, every node evaluatePosition() visits is recorded when it is
+    entered (with its window) and left (with its score and the reason it was left) in a ring buffer of fixed size, which
+    keeps the most recent records and never blocks or allocates. A context is only used by one thread at a time, so each
+    thread writes to a buffer of its own; other threads may take a snapshot at any time. The buffer can be written to a
+    file and printed as a tree by `traceview`. */
+
+// trace file header: magic, version, record size and number of records
+#define TRACE_MAGIC 0x52544843u // "CHTR"
+#define TRACE_VERSION 1
+#define TRACE_HEADER_SIZE 16
+
+// default number of records in a trace buffer (a power of two)
+#define TRACE_RECORDS (1 << 20)
+
+// kinds of trace records
+enum TraceEvent : uint8_t {
+    TRACE_SEARCH, // a search of the root moves to a given depth begins
+    TRACE_ENTER, // a node is entered
+    TRACE_EXIT // a node is left
+};
+
+// reasons for leaving a node
+enum class TraceReason : uint8_t {
+    SEARCHED, // every move was searched
+    CUTOFF, // a move was good enough to refute the previous move
+    TT_CUTOFF, // the transposition table held a deep enough result
+    TABLEBASE, // the endgame tablebases know the result
+    TERMINAL, // the game is over
+    HORIZON, // the quiescence search took over
+    ABORTED // the search was interrupted
+};
+
+// the record flags
+#define TRACE_TT_HIT 1 // the transposition table held the position
+
+struct TraceRecord {
+    TraceEvent event;
+    TraceReason reason; // why the node was left (exit records)
+    uint8_t depth; // depth left (the depth of the search for search records)
+    uint8_t flags;
+    uint16_t ply; // ply of the node on the board (of the root for search records)
+    uint16_t move; // move that led to the node: to | from << 6 | promotion << 12, with squares numbered a1 = 0 ... h8 = 63
+    int32_t alpha, beta; // window (enter records)
+    int32_t score; // score (exit records)
+    uint32_t search; // number of the search the record belongs to
+};
+static_assert(sizeof(TraceRecord) == 24);
+
+// a ring buffer of trace records with a single writer
+class SearchTrace {
+private:
+    std::unique_ptr<TraceRecord[]> records;
+    size_t mask;
+    std::atomic<uint64_t> head = 0; // number of records written so far
+    uint32_t searches = 0;
+
+    // the move that led to the current position
+    static uint16_t lastMove(const Board& board) {
+        const GameState& state = board.state();
+        if(!state.moved) return 0;
+        const int from = 8 * (state.from.rank - 1) + (state.from.file - 1);
+        const int to = 8 * (state.to.rank - 1) + (state.to.file - 1);
+        return to | (from << 6) | ((state.promoted ? PIECE_TYPE(state.promoted) : 0) << 12);
+    }
+
+    void write(const TraceRecord& record) {
+        const uint64_t n = head.load(std::memory_order_relaxed);
+        records[n & mask] = record;
+        head.store(n + 1, std::memory_order_release);
+    }
+
+public:
+    // a buffer of `size` records (rounded up to a power of two)
+    SearchTrace(size_t size = TRACE_RECORDS) {
+        size_t n = 1;
+        while(n < size) n <<= 1;
+        records.reset(new TraceRecord[n]());
+        mask = n - 1;
+    }
+
+    // record the start of a search of the root moves of `board` to depth `depth`
+    void search(const Board& board, unsigned int depth) {
+        write({TRACE_SEARCH, TraceReason::SEARCHED, (uint8_t) depth, 0, board.ply, 0, 0, 0, 0, ++searches});
+    }
+
+    // record entering the current position with window [`alpha`, `beta`] and `depth` plies left
+    void enter(const Board& board, int alpha, int beta, unsigned int depth) {
+        write({TRACE_ENTER, TraceReason::SEARCHED, (uint8_t) depth, 0, board.ply, lastMove(board), alpha, beta, 0, searches});
+    }
+
+    // record leaving the current position with `score`
+    void exit(const Board& board, int score, TraceReason reason, bool ttHit) {
+        write({TRACE_EXIT, reason, 0, (uint8_t) (ttHit ? TRACE_TT_HIT : 0), board.ply, lastMove(board), 0, 0, score, searches});
+    }
+
+    // copy the records still in the buffer (oldest first) into `copy` - safe to call while the writer is running, in which
+    // case records overwritten during the copy are left out
+    void snapshot(std::vector<TraceRecord>& copy) const {
+        const uint64_t end = head.load(std::memory_order_acquire);
+        const uint64_t begin = (end > mask) ? end - mask - 1 : 0;
+        copy.clear();
+        for(uint64_t i = begin; i < end; i++) copy.push_back(records[i & mask]);
+
+        // drop the records whose slots the writer may have reused meanwhile (including the one it may be writing)
+        const uint64_t now = head.load(std::memory_order_acquire);
+        const uint64_t safe = (now > mask) ? std::min(now - mask, end) : 0;
+        if(safe > begin) copy.erase(copy.begin(), copy.begin() + (safe - begin));
+    }
+
+    // write the records in the buffer to `path` - returns true upon success
+    bool dump(const char * path) const {
+        std::vector<TraceRecord> copy;
+        snapshot(copy);
+
+        const uint32_t header[TRACE_HEADER_SIZE / 4] = {TRACE_MAGIC, TRACE_VERSION, sizeof(TraceRecord), (uint32_t) copy.size()};
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        return file.write((const char *) header, sizeof(header)) && file.write((const char *) copy.data(), copy.size() * sizeof(TraceRecord));
+    }
+};
@@ -0,0 +1,157 @@
+#include <fstream>
+#include <iostream>
+#include <getopt.h>
+
+#include "trace.h"
+
+/* Search trace viewer: prints the tree of nodes recorded in a trace file (written by `chess -T`).
+
+    traceview -l trace.bin                 lists the searches in the trace
+    traceview trace.bin                    prints the first two plies of the last search
+    traceview -s 12 -d 3 trace.bin e2e4    prints three plies below 1. e4 in search 12
+
+    Each node is printed with the depth left, the window it was entered with, its score and why it was left ("cutoff",
+    "tt" for transposition table cutoffs, ...), followed by "hit" if the transposition table held the position. Moves are
+    given as their squares (and promotion piece), e.g. e7e8q.
+*/
+
+// a node of the reconstructed tree
+struct TraceNode {
+    TraceRecord enter, exit;
+    bool left = false; // whether the exit was recorded
+    std::vector<size_t> children;
+};
+
+// long algebraic description of an encoded move
+std::string moveString(uint16_t move) {
+    std::string s;
+    for(int square : {(move >> 6) & 63, move & 63}) {
+        s += (char) ('a' + square % 8);
+        s += (char) ('1' + square / 8);
+    }
+    if(move >> 12) s += "pnbrqk"[move >> 12];
+    return s;
+}
+
+// readable score
+std::string scoreString(int score) {
+    if(score == INT_MIN) return "-inf";
+    if(score == INT_MAX) return "inf";
+    if(IS_MATE(score)) return (score > 0 ? "#" : "-#") + std::to_string(MATE(score));
+    return std::to_string(score);
+}
+
+const char * const REASONS[] = {"searched", "cutoff", "tt", "tablebase", "terminal", "horizon", "aborted"};
+
+// print `node` and its descendants up to `levels` plies below it
+void print(const std::vector<TraceNode>& nodes, size_t node, unsigned int indent, unsigned int levels) {
+    const TraceNode& n = nodes[node];
+    std::cout << std::string(2 * indent, ' ') << moveString(n.enter.move) << "  d" << (int) n.enter.depth << " ["
+              << scoreString(n.enter.alpha) << ", " << scoreString(n.enter.beta) << "]";
+    if(n.left) {
+        std::cout << " -> " << scoreString(n.exit.score) << " " << REASONS[(int) n.exit.reason];
+        if(n.exit.flags & TRACE_TT_HIT) std::cout << " hit";
+    } else std::cout << " (not left)";
+    std::cout << "\n";
+
+    if(levels)
+        for(size_t child : n.children) print(nodes, child, indent + 1, levels - 1);
+}
+
+int main(int argc, char * argv[]) {
+    bool list = false;
+    uint32_t search = 0;
+    unsigned int levels = 2;
+
+    int opt;
+    while((opt = getopt(argc, argv, "d:ls:")) != -1) {
+        switch(opt) {
+            case 'd':
+                levels = std::max(1, std::stoi(optarg));
+                break;
+            case 'l':
+                list = true;
+                break;
+            case 's':
+                search = std::stoul(optarg);
+                break;
+            default:
+                optind = argc + 1;
+        }
+    }
+    if(optind >= argc) {
+        std::cerr << "Usage: traceview [options] file [move ...]\n";
+        std::cerr << "-d plies  : number of plies printed below the line (default: 2)\n";
+        std::cerr << "-l        : list the searches in the trace\n";
+        std::cerr << "-s search : search to print (default: the last one)" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // load the trace
+    std::ifstream file(argv[optind], std::ios::binary);
+    uint32_t header[TRACE_HEADER_SIZE / 4];
+    if(!file.read((char *) header, sizeof(header)) || header[0] != TRACE_MAGIC || header[1] != TRACE_VERSION || header[2] != sizeof(TraceRecord)) {
+        std::cerr << "Could not read trace file '" << argv[optind] << "'\n";
+        return EXIT_FAILURE;
+    }
+    std::vector<TraceRecord> records(header[3]);
+    if(!file.read((char *) records.data(), records.size() * sizeof(TraceRecord))) {
+        std::cerr << "Trace file '" << argv[optind] << "' is truncated\n";
+        return EXIT_FAILURE;
+    }
+
+    // searches whose start is still in the trace
+    if(list) {
+        for(size_t i = 0; i < records.size(); i++) {
+            if(records[i].event != TRACE_SEARCH) continue;
+            size_t nodes = 0;
+            for(size_t j = i + 1; j < records.size() && records[j].event != TRACE_SEARCH; j++) nodes += records[j].event == TRACE_ENTER;
+            std::cout << "search " << records[i].search << ": ply " << records[i].ply << ", depth " << (int) records[i].depth << ", " << nodes << " nodes\n";
+        }
+        return 0;
+    }
+
+    size_t start = records.size();
+    for(size_t i = 0; i < records.size(); i++)
+        if(records[i].event == TRACE_SEARCH && (!search || records[i].search == search)) start = i;
+    if(start == records.size()) {
+        std::cerr << "The search isn't in the trace\n";
+        return EXIT_FAILURE;
+    }
+
+    // rebuild the tree (the root stands for the position searched)
+    std::vector<TraceNode> nodes(1);
+    std::vector<size_t> stack = {0};
+    for(size_t i = start + 1; i < records.size() && records[i].event != TRACE_SEARCH; i++) {
+        const TraceRecord& record = records[i];
+        if(record.event == TRACE_ENTER) {
+            nodes[stack.back()].children.push_back(nodes.size());
+            stack.push_back(nodes.size());
+            nodes.emplace_back();
+            nodes.back().enter = record;
+        } else if(stack.size() > 1) {
+            TraceNode& node = nodes[stack.back()];
+            node.exit = record;
+            node.left = true;
+            stack.pop_back();
+        }
+    }
+
+    // follow the line
+    size_t node = 0;
+    for(int i = optind + 1; i < argc; i++) {
+        size_t next = 0;
+        for(size_t child : nodes[node].children)
+            if(moveString(nodes[child].enter.move) == argv[i]) next = child;
+        if(!next) {
+            std::cerr << "The line wasn't searched beyond " << (i == optind + 1 ? "the root" : argv[i - 1]) << "\n";
+            return EXIT_FAILURE;
+        }
+        node = next;
+    }
+
+    std::cout << "search " << records[start].search << " (ply " << records[start].ply << ", depth " << (int) records[start].depth << ")\n";
+    for(size_t child : nodes[node].children) print(nodes, child, 0, levels - 1);
+
+    return 0;
+}
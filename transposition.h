@@ -0,0 +1,112 @@
+#pragma once
+
+#include <fstream>
+#include <memory>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "types.h"
+#include "zobrist.h"
+
+// transposition table file header: magic, version, entry size, number of entries and a fingerprint of the Zobrist keys
+#define TT_MAGIC 0x54544843u // "CHTT"
+#define TT_VERSION 2
+#define TT_HEADER_SIZE 32
+
+// identifies the Zobrist keys the stored positions were hashed with (the keys are fixed at compile time, but a file
+// written by a build with different keys would only produce wrong hits)
+#define TT_KEY_FINGERPRINT (ZOBRIST.pieces[WHITE][KING][1][E] ^ ZOBRIST.castling[BLACK][1] ^ ZOBRIST.blackToPlay)
+
+/* The transposition table: positions searched so far, indexed by their Zobrist key modulo the number of entries. The
+    entries either live in memory or in a file mapped with open(), in which case every update made by the search goes
+    straight to the file - a long analysis can be resumed later, or by another process, with all its entries. */
+class TranspositionTable {
+private:
+    std::unique_ptr<Position[]> memory; // entries when the table isn't mapped
+    Position * entries;
+    size_t count;
+    void * mapping = NULL; // mapped file (header and entries)
+    size_t length = 0;
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t entrySize;
+        uint32_t reserved;
+        uint64_t entries;
+        uint64_t fingerprint;
+    };
+    static_assert(sizeof(Header) == TT_HEADER_SIZE);
+
+public:
+    TranspositionTable(size_t count) : memory(new Position[count]()), entries(memory.get()), count(count) {}
+    TranspositionTable(const TranspositionTable&) = delete;
+    TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+    ~TranspositionTable() {
+        if(mapping) munmap(mapping, length);
+    }
+
+    // number of entries
+    size_t size() const { return count; }
+
+    // the entry for the position with key `key` (which may hold a different position)
+    Position& operator[](ZobristHash key) { return entries[key % count]; }
+    const Position& operator[](ZobristHash key) const { return entries[key % count]; }
+
+    // write the table to `path` - returns true upon success
+    bool save(const char * path) const {
+        const Header header = {TT_MAGIC, TT_VERSION, sizeof(Position), 0, count, TT_KEY_FINGERPRINT};
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        return file.write((const char *) &header, sizeof(header)) && file.write((const char *) entries, count * sizeof(Position));
+    }
+
+    // use the table in the file at `path` (written by save(), or by a mapped table) from now on, creating the file from
+    // the current entries if it doesn't exist - returns false if the file can't be mapped or has an incompatible layout
+    bool open(const char * path) {
+        if(access(path, F_OK) && !save(path)) return false;
+
+        int fd = ::open(path, O_RDWR);
+        if(fd < 0) return false;
+
+        struct stat st;
+        Header header;
+        if(fstat(fd, &st) || (size_t) st.st_size < TT_HEADER_SIZE || pread(fd, &header, sizeof(header), 0) != sizeof(header)
+            || header.magic != TT_MAGIC || header.version != TT_VERSION || header.entrySize != sizeof(Position)
+            || header.fingerprint != TT_KEY_FINGERPRINT || !header.entries
+            || (size_t) st.st_size != TT_HEADER_SIZE + header.entries * sizeof(Position)) {
+            ::close(fd);
+            return false;
+        }
+
+        void * file = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if(file == MAP_FAILED) return false;
+
+        close();
+        madvise(file, st.st_size, MADV_RANDOM);
+        mapping = file;
+        length = st.st_size;
+        entries = (Position *) ((uint8_t *) file + TT_HEADER_SIZE);
+        count = header.entries;
+        memory.reset();
+        return true;
+    }
+
+    // stop using a mapped file (the table is emptied)
+    void close() {
+        if(mapping) resize(count);
+    }
+
+    // replace the table with an empty in-memory table of `count` entries
+    void resize(size_t count) {
+        if(mapping) munmap(mapping, length);
+        mapping = NULL;
+        memory.reset(new Position[count]());
+        entries = memory.get();
+        this->count = count;
+    }
+};
@@ -0,0 +1,343 @@
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <getopt.h>
+
+#include "board.h"
+#include "packed.h"
+
+/* Evaluation tuner: fits the evaluation weights to positions labelled with game results (Texel's tuning method).
+
+    The evaluation is linear in its weights, so the terms of each position are computed once while loading (on one board
+    per thread that is reset in place for every position) and an iteration only takes dot products of small integer
+    vectors. The mean squared error between the results and the scores predicted by the evaluation (a logistic function
+    of the evaluation whose scaling constant K is fitted first) is minimized by gradient descent (Adam), with the error
+    and gradient summed in parallel. Positions that aren't quiet (the side to play is in check or has a capture that wins
+    material), dead draws, known endings and endings whose evaluation is scaled down (see material.h) are skipped.
+
+    Each line of the input holds a FEN followed by the result, written as 1-0, 0-1 or 1/2-1/2 (optionally quoted, as in
+    EPD `c9` opcodes) or as 1.0, 0.5 or 0.0 (optionally in brackets). Packed position files (written by datagen) are
+    recognized by their header and loaded without any text parsing.
+*/
+
+// a labelled position reduced to its evaluation terms
+struct Sample {
+    int16_t terms[EVAL_TERMS];
+    float result; // 1 = white wins, 0.5 = draw, 0 = black wins
+};
+
+// evaluation weights being tuned (in centipawns)
+typedef std::array<double, EVAL_TERMS> Weights;
+
+// parse the result at the end of `line` and remove it (along with any separators) - returns a negative value if the
+// line doesn't end with a result
+float parseResult(std::string_view& line) {
+    auto trim = [&line](std::string_view characters) {
+        while(!line.empty() && characters.find(line.back()) != std::string_view::npos) line.remove_suffix(1);
+    };
+
+    trim(" \t\r;");
+    const size_t space = line.find_last_of(" \t");
+    if(space == std::string_view::npos) return -1;
+    std::string_view token = line.substr(space + 1);
+    line = line.substr(0, space);
+
+    while(!token.empty() && (token.front() == '"' || token.front() == '[')) token.remove_prefix(1);
+    while(!token.empty() && (token.back() == '"' || token.back() == ']')) token.remove_suffix(1);
+
+    float result = -1;
+    if(token == "1-0" || token == "1.0" || token == "1") result = 1;
+    else if(token == "0-1" || token == "0.0" || token == "0") result = 0;
+    else if(token == "1/2-1/2" || token == "0.5") result = 0.5;
+
+    // separators between the FEN and the result
+    trim(" \t|,;");
+    if(line.size() > 3 && line.substr(line.size() - 3) == " c9") line.remove_suffix(3);
+    trim(" \t");
+    return result;
+}
+
+// whether the position is quiet enough for its static evaluation to be meaningful
+bool quiet(Board& board) {
+    if(board.inCheck(board.toPlay)) return false;
+    for(const Move& move : board.getPseudoLegalMoves(board.toPlay))
+        if((move.captureType != CaptureType::NONE || move.moveType == MoveType::PROMOTION) && board.see(move) > 0) return false;
+    return true;
+}
+
+// whether the position is evaluated by weighing its terms alone (rather than as a draw, a known ending or a scaled
+// down ending)
+bool linear(const Board& board) {
+    const MaterialEntry material = analyzeMaterial(board.state().material);
+    return board.result == GameResult::IN_PROGRESS && material.ending == Ending::NONE
+        && material.scale[WHITE] == SCALE_NORMAL && material.scale[BLACK] == SCALE_NORMAL;
+}
+
+// load the labelled positions of `text` into `samples` using `threads` threads - returns the number of lines skipped
+size_t load(std::string_view text, std::vector<Sample>& samples, unsigned int threads) {
+    // split the text at line breaks into one part per thread
+    std::vector<std::string_view> parts;
+    for(unsigned int i = 0; i < threads && !text.empty(); i++) {
+        size_t end = (i == threads - 1) ? text.size() : std::min(text.find('\n', text.size() / (threads - i)), text.size());
+        parts.push_back(text.substr(0, end));
+        text.remove_prefix(std::min(end + 1, text.size()));
+    }
+
+    std::vector<std::vector<Sample>> loaded(parts.size());
+    std::vector<size_t> skipped(parts.size(), 0);
+    std::vector<std::thread> pool;
+    for(size_t i = 0; i < parts.size(); i++) {
+        pool.emplace_back([&, i]() {
+            Board board;
+            std::string_view part = parts[i];
+            while(!part.empty()) {
+                const size_t end = std::min(part.find('\n'), part.size());
+                std::string_view line = part.substr(0, end);
+                part.remove_prefix(std::min(end + 1, part.size()));
+                if(line.find_first_not_of(" \t\r") == std::string_view::npos) continue;
+
+                int terms[EVAL_TERMS];
+                Sample sample;
+                if((sample.result = parseResult(line)) < 0 || !board.setPosition(line) || !linear(board) || !quiet(board)) {
+                    skipped[i]++;
+                    continue;
+                }
+
+                board.evaluationTerms(terms);
+                for(int term = 0; term < EVAL_TERMS; term++) sample.terms[term] = terms[term];
+                loaded[i].push_back(sample);
+            }
+        });
+    }
+    for(std::thread& worker : pool) worker.join();
+
+    size_t total = 0;
+    for(size_t i = 0; i < parts.size(); i++) {
+        samples.insert(samples.end(), loaded[i].begin(), loaded[i].end());
+        total += skipped[i];
+    }
+    return total;
+}
+
+// load the positions of the packed position file `file` into `samples` using `threads` threads - returns the number of
+// positions skipped
+size_t load(const PackedPositionFile& file, std::vector<Sample>& samples, unsigned int threads) {
+    const size_t n = file.size();
+    std::vector<std::vector<Sample>> loaded(threads);
+    std::vector<size_t> skipped(threads, 0);
+    std::vector<std::thread> pool;
+    for(unsigned int thread = 0; thread < threads; thread++) {
+        pool.emplace_back([&, thread]() {
+            Board board;
+            for(size_t i = n * thread / threads; i < n * (thread + 1) / threads; i++) {
+                int terms[EVAL_TERMS];
+                if(!file[i].unpack(board) || !linear(board) || !quiet(board)) {
+                    skipped[thread]++;
+                    continue;
+                }
+
+                Sample sample;
+                sample.result = file[i].result / 2.0f;
+                board.evaluationTerms(terms);
+                for(int term = 0; term < EVAL_TERMS; term++) sample.terms[term] = terms[term];
+                loaded[thread].push_back(sample);
+            }
+        });
+    }
+    for(std::thread& worker : pool) worker.join();
+
+    size_t total = 0;
+    for(unsigned int thread = 0; thread < threads; thread++) {
+        samples.insert(samples.end(), loaded[thread].begin(), loaded[thread].end());
+        total += skipped[thread];
+    }
+    return total;
+}
+
+// mean squared error of the scores predicted with `weights` and scaling constant `k` - the gradient with respect to the
+// weights is stored in `gradient` if given
+double error(const std::vector<Sample>& samples, const Weights& weights, double k, unsigned int threads, Weights * gradient = NULL) {
+    const size_t n = samples.size();
+    std::vector<double> errors(threads, 0);
+    std::vector<Weights> gradients(threads);
+    std::vector<std::thread> pool;
+
+    for(unsigned int thread = 0; thread < threads; thread++) {
+        pool.emplace_back([&, thread]() {
+            double sum = 0;
+            Weights& local = gradients[thread];
+            local.fill(0);
+
+            for(size_t i = n * thread / threads; i < n * (thread + 1) / threads; i++) {
+                const Sample& sample = samples[i];
+                double evaluation = 0;
+                for(int term = 0; term < EVAL_TERMS; term++) evaluation += weights[term] * sample.terms[term];
+
+                // predicted score (the probability of a white win, counting draws as half) and its error
+                const double score = 1 / (1 + std::exp(-k * evaluation * std::log(10.0) / 400));
+                const double difference = sample.result - score;
+                sum += difference * difference;
+
+                if(gradient) {
+                    const double slope = -2 * difference * score * (1 - score) * k * std::log(10.0) / 400;
+                    for(int term = 0; term < EVAL_TERMS; term++) local[term] += slope * sample.terms[term];
+                }
+            }
+            errors[thread] = sum;
+        });
+    }
+    for(std::thread& worker : pool) worker.join();
+
+    double sum = 0;
+    for(double e : errors) sum += e;
+    if(gradient) {
+        gradient->fill(0);
+        for(const Weights& local : gradients)
+            for(int term = 0; term < EVAL_TERMS; term++) (*gradient)[term] += local[term] / n;
+    }
+    return sum / n;
+}
+
+// fit the scaling constant K to the current weights (golden section search)
+double fitScale(const std::vector<Sample>& samples, const Weights& weights, unsigned int threads) {
+    const double ratio = (std::sqrt(5.0) - 1) / 2;
+    double low = 0.05, high = 4;
+    for(int i = 0; i < 40; i++) {
+        const double k1 = high - ratio * (high - low), k2 = low + ratio * (high - low);
+        if(error(samples, weights, k1, threads) < error(samples, weights, k2, threads)) high = k2;
+        else low = k1;
+    }
+    return (low + high) / 2;
+}
+
+// write the tuned weights as the weights.h header
+void writeHeader(std::ostream& out, const Weights& weights, size_t positions, double e) {
+    auto weight = [&weights](EvalTerm term) { return (int) std::lround(weights[term]); };
+
+    out << "#pragma once\n\n";
+    out << "/* Evaluation weights (in centipawns). This file is generated by `tune`, which fits the weights to a set of positions\n";
+    out << "   labelled with game results (see tune.cpp):\n\n";
+    out << "    ./tune -o weights.h positions.epd\n\n";
+    out << "   These weights were fitted to " << positions << " positions (mean squared error " << e << ").\n";
+    out << "*/\n\n";
+    out << "// piece values (the king's value is only used by the static exchange evaluation and isn't tuned)\n";
+    out << "const int PIECE_VALUES[6] = { " << weight(TERM_PAWNS) << ", " << weight(TERM_KNIGHTS) << ", " << weight(TERM_BISHOPS)
+        << ", " << weight(TERM_ROOKS) << ", " << weight(TERM_QUEENS) << ", " << PIECE_VALUES[KING] << " };\n\n";
+    out << "// bonus for having both bishops\n";
+    out << "const int BISHOP_PAIR_BONUS = " << weight(TERM_BISHOP_PAIR) << ";\n\n";
+    out << "// penalty per doubled pawn (each pawn beyond the first on a file)\n";
+    out << "const int DOUBLED_PAWN_PENALTY = " << -weight(TERM_DOUBLED_PAWNS) << ";\n\n";
+    out << "// penalty per isolated pawn\n";
+    out << "const int ISOLATED_PAWN_PENALTY = " << -weight(TERM_ISOLATED_PAWNS) << ";\n\n";
+    out << "// bonus per pseudolegal move\n";
+    out << "const int MOBILITY_BONUS = " << weight(TERM_MOBILITY) << ";\n";
+}
+
+int main(int argc, char * argv[]) {
+    unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+    unsigned int iterations = 1000;
+    double rate = 1; // Adam step size (in centipawns)
+    double k = 0; // scaling constant (fitted if not given)
+    const char * output = NULL;
+
+    int opt;
+    while((opt = getopt(argc, argv, "i:j:k:o:r:")) != -1) {
+        switch(opt) {
+            case 'i':
+                iterations = std::stoi(optarg);
+                break;
+            case 'j':
+                threads = std::max(1, std::stoi(optarg));
+                break;
+            case 'k':
+                k = std::stod(optarg);
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            case 'r':
+                rate = std::stod(optarg);
+                break;
+            default:
+                optind = argc;
+        }
+    }
+    if(optind != argc - 1) {
+        std::cerr << "Usage: tune [options] positions\n";
+        std::cerr << "-i iterations : number of gradient descent iterations (default: 1000)\n";
+        std::cerr << "-j threads    : number of worker threads (default: all cores)\n";
+        std::cerr << "-k scale      : scaling constant of the evaluation (default: fitted to the positions)\n";
+        std::cerr << "-o file       : write the tuned weights header to <file> (default: standard output)\n";
+        std::cerr << "-r rate       : step size in centipawns (default: 1)" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // load positions
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<Sample> samples;
+    size_t skipped;
+    if(PackedPositionFile::identify(argv[optind])) {
+        PackedPositionFile file(argv[optind]);
+        if(!file.isOpen()) {
+            std::cerr << "Could not open positions file '" << argv[optind] << "'\n";
+            return EXIT_FAILURE;
+        }
+        skipped = load(file, samples, threads);
+    } else {
+        std::ifstream file(argv[optind], std::ios::binary);
+        if(!file) {
+            std::cerr << "Could not open positions file '" << argv[optind] << "'\n";
+            return EXIT_FAILURE;
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        skipped = load(buffer.str(), samples, threads);
+    }
+    std::cerr << "Loaded " << samples.size() << " positions (" << skipped << " skipped) in "
+              << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << "s" << std::endl;
+    if(samples.empty()) return EXIT_FAILURE;
+
+    // start from the current weights
+    Weights weights;
+    for(int term = 0; term < EVAL_TERMS; term++) weights[term] = EVAL_WEIGHTS[term];
+    if(!k) k = fitScale(samples, weights, threads);
+    std::cerr << "K = " << k << ", initial error " << error(samples, weights, k, threads) << std::endl;
+
+    // Adam
+    const double beta1 = 0.9, beta2 = 0.999, epsilon = 1e-8;
+    Weights gradient, m = {}, v = {};
+    double e = 0;
+    start = std::chrono::steady_clock::now();
+    for(unsigned int iteration = 1; iteration <= iterations; iteration++) {
+        e = error(samples, weights, k, threads, &gradient);
+        for(int term = 0; term < EVAL_TERMS; term++) {
+            m[term] = beta1 * m[term] + (1 - beta1) * gradient[term];
+            v[term] = beta2 * v[term] + (1 - beta2) * gradient[term] * gradient[term];
+            const double mHat = m[term] / (1 - std::pow(beta1, iteration)), vHat = v[term] / (1 - std::pow(beta2, iteration));
+            weights[term] -= rate * mHat / (std::sqrt(vHat) + epsilon);
+        }
+
+        if(iteration % 100 == 0 || iteration == iterations) {
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cerr << "Iteration " << iteration << ": error " << e << " (" << (uint64_t) (iteration * samples.size() / seconds)
+                      << " positions/s)" << std::endl;
+        }
+    }
+    e = error(samples, weights, k, threads);
+
+    // emit the header
+    if(output) {
+        std::ofstream out(output);
+        writeHeader(out, weights, samples.size(), e);
+        if(!out) {
+            std::cerr << "Could not write '" << output << "'\n";
+            return EXIT_FAILURE;
+        }
+    } else writeHeader(std::cout, weights, samples.size(), e);
+
+    return 0;
+}
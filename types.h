@@ -5,6 +5,7 @@
 /* user-defined types */
 
 typedef uint64_t ZobristHash;
+typedef uint64_t MaterialKey;
 typedef uint8_t Rank;
 
 enum File : uint8_t { NONE, A, B, C, D, E, F, G, H };
@@ -43,21 +44,79 @@ struct Piece {
     Coord location;
 };
 
-// alias for piece pointers
-typedef Piece * Square;
+// contents of a board square (EMPTY or a piece code)
+typedef uint8_t Square;
+
+// piece codes stored on board squares (1 - 6 = white pawn - king, 7 - 12 = black pawn - king)
+#define EMPTY ((Square) 0)
+#define PIECE_CODE(color, type) ((Square) (1 + 6 * (color) + (type)))
+#define PIECE_COLOR(square) ((PieceColor) (((square) - 1) / 6))
+#define PIECE_TYPE(square) ((PieceType) (((square) - 1) % 6))
+
+// maximum number of pieces of one color and type (two of a kind plus eight promoted pawns)
+#define PIECE_LIST_SIZE 10
+
+// the squares of one color's pieces of a given type (in no particular order)
+struct PieceList {
+    Coord squares[PIECE_LIST_SIZE];
+    uint8_t count = 0;
+
+    Coord * begin() { return squares; }
+    Coord * end() { return squares + count; }
+    const Coord * begin() const { return squares; }
+    const Coord * end() const { return squares + count; }
+
+    size_t size() const { return count; }
+    bool empty() const { return !count; }
+    bool full() const { return count == PIECE_LIST_SIZE; }
+    Coord front() const { return squares[0]; }
+
+    void clear() { count = 0; }
+    void push_back(Coord square) { squares[count++] = square; }
+
+    // remove the piece on `square` (the last piece takes its place)
+    void remove(Coord square) {
+        for(uint8_t i = 0; i < count; i++) {
+            if(squares[i].file != square.file || squares[i].rank != square.rank) continue;
+            squares[i] = squares[--count];
+            return;
+        }
+    }
+
+    // move the piece on `from` to `to`
+    void replace(Coord from, Coord to) {
+        for(uint8_t i = 0; i < count; i++) {
+            if(squares[i].file != from.file || squares[i].rank != from.rank) continue;
+            squares[i] = to;
+            return;
+        }
+    }
+};
 
-// represents info about the current game state
+// represents info about the current game state (one record per ply, holding what a move can't undo by itself)
 struct GameState {
+    ZobristHash key; // Zobrist hash of the position
+    MaterialKey material; // number of pieces of each color and type (see MATERIAL_SHIFT)
     bool canCastle[2][2]; // on which side(s) of the board each color has castling rights
-    Piece* passant; // candidate for being captured en passant
-    uint8_t plies; // number of half-moves (plies)
+    File passant; // file of the pawn that can be captured en passant (NONE if there isn't one)
+    uint8_t plies; // number of half-moves (plies) since the last capture or pawn move
+
+    // the move that led to this position (used to update evaluation state incrementally)
+    Square moved; // piece that moved (EMPTY for the initial position)
+    Square promoted; // piece a pawn promoted to (EMPTY if the move wasn't a promotion)
+    Square captured; // piece captured by the move (EMPTY if there wasn't one)
+    bool enPassant; // whether the capture was made en passant
+    Coord from, to; // starting and ending squares of the move
 };
 
+// size of a move description buffer (the longest description, e.g. "Qa1xb2+" or "e7xd8=Q#", plus a terminator)
+#define MOVE_STRING_SIZE 10
+
 // represents a move in memory
 struct Move {
-    char * algebraic; // algebraic notation move description
-    Piece * piece; // the moving piece
-    Piece * capture; // the piece captured by the move (if there is one)
+    char algebraic[MOVE_STRING_SIZE]; // algebraic notation move description (empty if not generated)
+    Piece piece; // the moving piece (as it was before the move)
+    Piece capture; // the piece captured by the move (only valid if captureType isn't NONE)
     Coord from, to; // starting and ending positions
     MoveType moveType; // type of move (normal, castling, promotion)
     CaptureType captureType; // type of capture (none, normal, en passant)
@@ -67,9 +126,9 @@ struct Move {
     int32_t evaluation; // numerical evaluation of move (not always calculated)
 
     Move() {
-        algebraic = NULL;
-        piece = NULL;
-        capture = NULL;
+        algebraic[0] = '\0';
+        piece = {PieceColor::WHITE, PieceType::PAWN, {File::NONE, 0}};
+        capture = {PieceColor::WHITE, PieceType::PAWN, {File::NONE, 0}};
         from = {(File) -1, (Rank) -1};
         to = {(File) 0, (Rank) 0};
         moveType = MoveType::NORMAL;
@@ -79,32 +138,19 @@ struct Move {
         mate = false;
         evaluation = 0;
     }
-
-    Move(const Move& move) {
-        memcpy(this, &move, sizeof(Move));
-
-        // if move has an algebraic notation string, make a deep copy of it to avoid double frees
-        if(move.algebraic) {
-            size_t size = strlen(move.algebraic) + 1;
-            algebraic = (char *) malloc(size);
-            strcpy(algebraic, move.algebraic);
-        }
-    }
-
-    ~Move() {
-        if(algebraic) {
-            free(algebraic);
-            algebraic = NULL;
-        }
-    }
 };
 
+// how a stored evaluation relates to the position's value: a search that fails high or low (the search fails soft) only
+// finds a bound on it
+enum Bound : uint8_t { EXACT, LOWER, UPPER };
+
 // represents a chess position
 struct Position {
     uint64_t key; // Zobrist hash of position
     Move bestMove; // best move or refutation move
     int32_t evaluation; // numerical evaluation
-    uint32_t depth; // depth of evaluation
+    uint16_t depth; // depth of evaluation
+    Bound bound; // whether the evaluation is exact or a lower or upper bound
 };
 
 /* operator overloads */
@@ -147,10 +193,13 @@ bool operator==(const Piece& p1, const Piece& p2) {
 }
 
 bool operator==(const Move& m1, const Move& m2) {
-    return m1.piece->type == m2.piece->type && m1.from == m2.from && m2.to == m2.to;
+    return m1.piece.type == m2.piece.type && m1.from == m2.from && m1.to == m2.to && m1.promoteTo == m2.promoteTo;
 }
 
 /* constants */
+// directions in which ranged pieces move (the four rook directions, then the four bishop directions)
+const CoordOffset DIRECTIONS[8] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}, {1, 1}, {-1, 1}, {1, -1}, {-1, -1}};
+
 const PieceType PIECE_TYPES[6] = {
     PieceType::PAWN,
     PieceType::KNIGHT,
@@ -159,29 +208,3 @@ const PieceType PIECE_TYPES[6] = {
     PieceType::QUEEN,
     PieceType::KING
 };
-
-// represents a linear range of coordinate offsets (used for bishops, rooks, and queens)
-class Range {
-private:
-    CoordOffset start, step, _next;
-    int i = 0;
-
-public:
-    Range(CoordOffset start, CoordOffset step) : start(start), _next(start), step(step) {}
-
-    CoordOffset next() {
-        CoordOffset next = _next;
-        _next = _next + step;
-        i++;
-        return next;
-    }
-
-    bool hasNext() const {
-        return (i < 8);
-    }
-    
-    void reset() {
-        _next = start;
-        i = 0;
-    }
-};
@@ -0,0 +1,24 @@
+#pragma once
+
+/* Evaluation weights (in centipawns). This file is generated by `tune`, which fits the weights to a set of positions
+   labelled with game results (see tune.cpp):
+
+    ./tune -o weights.h positions.epd
+
+   These are the original hand-picked weights.
+*/
+
+// piece values (the king's value is only used by the static exchange evaluation and isn't tuned)
+const int PIECE_VALUES[6] = { 100, 300, 300, 500, 900, 99999 };
+
+// bonus for having both bishops
+const int BISHOP_PAIR_BONUS = 30;
+
+// penalty per doubled pawn (each pawn beyond the first on a file)
+const int DOUBLED_PAWN_PENALTY = 50;
+
+// penalty per isolated pawn
+const int ISOLATED_PAWN_PENALTY = 50;
+
+// bonus per pseudolegal move
+const int MOBILITY_BONUS = 10;
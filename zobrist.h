@@ -0,0 +1,38 @@
+#pragma once
+
+#include "random.h"
+#include "types.h"
+
+// Zobrist hash values, generated at compile time so that keys are identical across processes and Board instances
+struct ZobristKeys {
+    uint64_t pieces[2][6][9][9]; // color/piece-type/square combos (indexed by rank and file, padded like the board)
+    uint64_t castling[2][2]; // castling rights (indexed by color and side)
+    uint64_t passant[9]; // en passant candidate files
+    uint64_t blackToPlay; // encodes that black is to play
+};
+
+constexpr ZobristKeys generateZobristKeys() {
+    ZobristKeys keys = {};
+    Random random(0x5a0b1257u);
+
+    for(int color = WHITE; color <= BLACK; color++) {
+        // color-piece-square combos
+        for(int type = PAWN; type <= KING; type++)
+            for(int rank = 1; rank <= 8; rank++)
+                for(int file = A; file <= H; file++)
+                    keys.pieces[color][type][rank][file] = random.rand64();
+
+        // castling rights
+        for(int side = 0; side < 2; side++) keys.castling[color][side] = random.rand64();
+    }
+
+    // passant files
+    for(int file = A; file <= H; file++) keys.passant[file] = random.rand64();
+
+    // black to play
+    keys.blackToPlay = random.rand64();
+
+    return keys;
+}
+
+constexpr ZobristKeys ZOBRIST = generateZobristKeys();